@@ -0,0 +1,269 @@
+// Software layer compositor with crossfade/slide transitions for the panel
+#pragma once
+
+#include <config.h>
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+
+#ifndef CONFIG_TRANSITION_MS
+#define CONFIG_TRANSITION_MS 400
+#endif
+
+// Alpha is 0..32 so the blend is a multiply and a 5 bit shift
+#define ALPHA_OPAQUE 32
+
+// RGB565 is spread over 32 bits as 00000gggggg00000rrrrr000000bbbbb so all
+// three channels are blended with one multiply, with room for the carries
+static inline uint32_t expand565(uint16_t c)
+{
+    return (c | ((uint32_t)c << 16)) & 0x07E0F81F;
+}
+
+static inline uint16_t compact565(uint32_t c)
+{
+    return (uint16_t)(c | (c >> 16));
+}
+
+static inline uint16_t blend565(uint16_t bg, uint16_t fg, uint8_t alpha)
+{
+    uint32_t b = expand565(bg);
+    uint32_t f = expand565(fg);
+    return compact565(((((f - b) * alpha) >> 5) + b) & 0x07E0F81F);
+}
+
+// out[i] = bg[i] blended towards fg[i]; out may alias bg
+static inline void blendRow565(uint16_t *out, const uint16_t *bg, const uint16_t *fg, int n, uint8_t alpha)
+{
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        out[i] = blend565(bg[i], fg[i], alpha);
+        out[i + 1] = blend565(bg[i + 1], fg[i + 1], alpha);
+        out[i + 2] = blend565(bg[i + 2], fg[i + 2], alpha);
+        out[i + 3] = blend565(bg[i + 3], fg[i + 3], alpha);
+    }
+    for (; i < n; ++i)
+        out[i] = blend565(bg[i], fg[i], alpha);
+}
+
+// Same as blendRow565 but pixels equal to key leave the background untouched
+static inline void blendRowKeyed565(uint16_t *out, const uint16_t *bg, const uint16_t *fg, int n, uint8_t alpha, uint16_t key)
+{
+    for (int i = 0; i < n; ++i)
+        out[i] = fg[i] == key ? bg[i] : blend565(bg[i], fg[i], alpha);
+}
+
+enum LayerId
+{
+    LAYER_COVER,
+    LAYER_CLOCK,
+    LAYER_CALENDAR,
+    LAYER_OVERLAY,
+    LAYER_COUNT
+};
+
+#define LAYER_BIT(id) (1u << (id))
+
+class Compositor
+{
+public:
+    enum class Transition
+    {
+        Cut,
+        Crossfade,
+        Slide
+    };
+
+    static const int width = PANEL_RES_X;
+    static const int height = PANEL_RES_Y;
+
+    // With a double buffered display every frame is drawn into the buffer
+    // that missed the previous one, so rows pushed last frame go out again
+    bool begin(bool doubleBufferedDisplay = false)
+    {
+        doubleBuffered = doubleBufferedDisplay;
+        scene = (uint16_t *)calloc(width * height, sizeof(uint16_t));
+        previous = (uint16_t *)calloc(width * height, sizeof(uint16_t));
+        return scene && previous;
+    }
+
+    // Layers are drawn bottom to top in LayerId order. Keyed layers treat
+    // black as transparent so text can sit on top of the layers below.
+    void attach(LayerId id, GFXcanvas16 *canvas, bool keyed = false)
+    {
+        layers[id].canvas = canvas;
+        layers[id].keyed = keyed;
+        invalidate();
+    }
+
+    void setAlpha(LayerId id, uint8_t alpha)
+    {
+        if (layers[id].alpha != alpha)
+        {
+            layers[id].alpha = alpha > ALPHA_OPAQUE ? ALPHA_OPAQUE : alpha;
+            invalidate();
+        }
+    }
+
+    // Call after drawing into a layer canvas
+    void invalidate() { invalidateRows(0, height); }
+
+    // Only rows [top, bottom) are recomposed and pushed on the next frame
+    void invalidateRows(int top, int bottom)
+    {
+        if (top < dirtyTop)
+            dirtyTop = top < 0 ? 0 : top;
+        if (bottom > dirtyBottom)
+            dirtyBottom = bottom > height ? height : bottom;
+    }
+
+    // Make the layers in mask the visible set. A change of set animates from
+    // the current frame; the same set only redraws the changed content.
+    void show(uint32_t mask, Transition transition, unsigned long now)
+    {
+        if (mask == visibleMask && mask != 0)
+        {
+            invalidate();
+            return;
+        }
+
+        visibleMask = mask;
+        startTransition(transition, now);
+    }
+
+    // Animate to new content drawn into the visible layers (e.g. next cover)
+    void refresh(Transition transition, unsigned long now)
+    {
+        startTransition(transition, now);
+    }
+
+    bool isAnimating() const { return animating; }
+    bool isShowing(uint32_t mask) const { return visibleMask == mask; }
+
+    // Draws the next frame into out; returns false when nothing changed
+    bool render(Adafruit_GFX &out, unsigned long now)
+    {
+        bool dirty = dirtyTop < dirtyBottom;
+        if (!dirty && !animating)
+            return false;
+
+        int top = dirtyTop;
+        int bottom = dirtyBottom;
+        if (dirty)
+            composeScene(top, bottom);
+        dirtyTop = height;
+        dirtyBottom = 0;
+
+        if (!animating)
+        {
+            int pushTop = top < staleTop ? top : staleTop;
+            int pushBottom = bottom > staleBottom ? bottom : staleBottom;
+            out.drawRGBBitmap(0, pushTop, &scene[pushTop * width], width, pushBottom - pushTop);
+            markPushed(top, bottom);
+            return true;
+        }
+
+        markPushed(0, height);
+        unsigned long elapsed = now - transitionStart;
+        if (elapsed >= CONFIG_TRANSITION_MS)
+        {
+            animating = false;
+            out.drawRGBBitmap(0, 0, scene, width, height);
+            return true;
+        }
+
+        uint16_t row[width];
+        if (activeTransition == Transition::Crossfade)
+        {
+            uint8_t alpha = (uint8_t)(elapsed * ALPHA_OPAQUE / CONFIG_TRANSITION_MS);
+            for (int y = 0; y < height; ++y)
+            {
+                blendRow565(row, &previous[y * width], &scene[y * width], width, alpha);
+                out.drawRGBBitmap(0, y, row, width, 1);
+            }
+        }
+        else
+        {
+            // New frame enters from the right, old one leaves to the left
+            int shift = (int)(elapsed * width / CONFIG_TRANSITION_MS);
+            for (int y = 0; y < height; ++y)
+            {
+                memcpy(row, &previous[y * width + shift], (width - shift) * sizeof(uint16_t));
+                memcpy(&row[width - shift], &scene[y * width], shift * sizeof(uint16_t));
+                out.drawRGBBitmap(0, y, row, width, 1);
+            }
+        }
+        return true;
+    }
+
+private:
+    struct Layer
+    {
+        GFXcanvas16 *canvas = nullptr;
+        uint8_t alpha = ALPHA_OPAQUE;
+        bool keyed = false;
+    };
+
+    Layer layers[LAYER_COUNT];
+    uint16_t *scene = nullptr;    // visible layers flattened
+    uint16_t *previous = nullptr; // frame the running transition starts from
+    uint32_t visibleMask = 0;
+    int dirtyTop = 0; // rows [dirtyTop, dirtyBottom) need recomposing
+    int dirtyBottom = height;
+    bool doubleBuffered = false;
+    int staleTop = height; // rows [staleTop, staleBottom) the back buffer missed
+    int staleBottom = 0;
+
+    bool animating = false;
+    Transition activeTransition = Transition::Cut;
+    unsigned long transitionStart = 0;
+
+    void startTransition(Transition transition, unsigned long now)
+    {
+        // The scene still holds the last composed frame; an unfinished
+        // transition snaps to it so the new one starts from a full frame
+        memcpy(previous, scene, width * height * sizeof(uint16_t));
+
+        invalidate();
+        activeTransition = transition;
+        animating = transition != Transition::Cut;
+        transitionStart = now;
+    }
+
+    void markPushed(int top, int bottom)
+    {
+        if (doubleBuffered)
+        {
+            staleTop = top;
+            staleBottom = bottom;
+        }
+    }
+
+    void composeScene(int top, int bottom)
+    {
+        uint16_t *dst = &scene[top * width];
+        int count = (bottom - top) * width;
+
+        memset(dst, 0, count * sizeof(uint16_t));
+        for (int id = 0; id < LAYER_COUNT; ++id)
+        {
+            const Layer &layer = layers[id];
+            if (!(visibleMask & LAYER_BIT(id)) || layer.canvas == nullptr || layer.alpha == 0)
+                continue;
+
+            const uint16_t *src = &layer.canvas->getBuffer()[top * width];
+            if (!layer.keyed && layer.alpha == ALPHA_OPAQUE)
+            {
+                memcpy(dst, src, count * sizeof(uint16_t));
+            }
+            else if (layer.keyed)
+            {
+                blendRowKeyed565(dst, dst, src, count, layer.alpha, 0x0000);
+            }
+            else
+            {
+                blendRow565(dst, dst, src, count, layer.alpha);
+            }
+        }
+    }
+};
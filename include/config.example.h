@@ -15,6 +15,9 @@
 // Uncomment to enable calendar support:
 // #define ENABLE_CALENDAR
 
+// Scrolling track and artist line over the album art. Comment out to disable.
+#define ENABLE_MARQUEE
+
 #define WF2_X1_R1_PIN 10 // in the smaller one the R B are changed
 #define WF2_X1_R2_PIN 11
 #define WF2_X1_G1_PIN 6
@@ -85,4 +88,67 @@
 // Nighttime brightness dimming factor (0.0 to 1.0)
 #define CONFIG_NIGHT_DIM_FACTOR 0.3f
 
+// ===== SPOTIFY POLLING SETTINGS =====
+// Max currently_playing requests per hour, counted in fixed one hour windows
+// (polling every 4s is ~900)
+#define CONFIG_SPOTIFY_HOURLY_BUDGET 900
+
+// Access tokens live 3600s; refresh this many seconds before they expire
+#define CONFIG_SPOTIFY_TOKEN_LIFETIME_S 3600
+#define CONFIG_SPOTIFY_TOKEN_REFRESH_MARGIN_S 300
+
+// Wait after a 429. SpotifyEsp32 does not expose the Retry-After header, so
+// this fixed wait is used instead
+#define CONFIG_SPOTIFY_RATE_LIMIT_WAIT_S 30
+
+// Exponential backoff after failed polls (doubles per consecutive failure)
+#define CONFIG_SPOTIFY_BACKOFF_BASE_MS 4000
+#define CONFIG_SPOTIFY_BACKOFF_MAX_MS 120000
+
+// Circuit breaker: after this many consecutive failures stop polling and show
+// the clock for the cooldown, then let a single probe request through
+#define CONFIG_SPOTIFY_BREAKER_THRESHOLD 5
+#define CONFIG_SPOTIFY_BREAKER_COOLDOWN_MS 300000
+
+// ===== DISPLAY SETTINGS =====
+// Duration of the crossfade/slide between cover and clock screens
+#define CONFIG_TRANSITION_MS 400
+
+// Album art size to fetch: 0 = 640px, 1 = 300px, 2 = 64px thumbnail.
+// Larger images are decoded at 1/2, 1/4 or 1/8 scale and averaged down to
+// the panel; a smaller size is used while the preferred one takes longer
+// than the budget to download and decode (or fails), re-trying it every few
+// tracks.
+#define CONFIG_ART_PREFERRED_INDEX 1
+#define CONFIG_ART_LATENCY_BUDGET_MS 1500
+#define CONFIG_ART_REPROBE_TRACKS 10
+
+// Marquee scroll speed: milliseconds per pixel step (50 = 20 px/s)
+#define CONFIG_MARQUEE_STEP_MS 50
+
+// ===== POWER SETTINGS =====
+// CPU clock while the loop works (polls, decoding, frames) and while it
+// sleeps until the next deadline. Keep the idle clock at 80MHz or above so
+// the panel DMA is unaffected.
+#define CONFIG_CPU_ACTIVE_MHZ 240
+#define CONFIG_CPU_IDLE_MHZ 80
+
+// Wi-Fi max modem sleep: beacon intervals (~102ms each) the radio sleeps
+// through between wakes. Higher saves more power but delays each poll reply.
+#define CONFIG_WIFI_LISTEN_INTERVAL 3
+
+// How often duty cycle, wake latency and the Spotify counters are logged
+#define CONFIG_POWER_REPORT_MS 60000
+
+// ===== LOG SETTINGS =====
+// 0 none, 1 error, 2 warn, 3 info, 4 debug. Disabled levels compile to nothing.
+#define CONFIG_LOG_LEVEL 3
+
+// 0: the log task prints text. 1: it sends compact binary records instead,
+// decode them with tools/log_decode.py and the matching firmware.elf
+#define CONFIG_LOG_BINARY 0
+
+// Bytes buffered for the log task; records are dropped (and counted) when full
+#define CONFIG_LOG_RING_SIZE 4096
+
 #endif // SPOTIFY_CLOCK_CONFIG_H
@@ -0,0 +1,157 @@
+// Album art sizing: area-averaging downsampler and image size selection
+#pragma once
+
+#include <config.h>
+#include <Arduino.h>
+
+#ifndef CONFIG_ART_PREFERRED_INDEX
+#define CONFIG_ART_PREFERRED_INDEX 1 // Spotify images: 0 = 640px, 1 = 300px, 2 = 64px
+#endif
+#ifndef CONFIG_ART_LATENCY_BUDGET_MS
+#define CONFIG_ART_LATENCY_BUDGET_MS 1500
+#endif
+#ifndef CONFIG_ART_REPROBE_TRACKS
+#define CONFIG_ART_REPROBE_TRACKS 10
+#endif
+
+#define ART_IMAGE_COUNT 3
+
+// Area-averaging downscale of an RGB565 image (sw >= dw, sh >= dh). Source
+// pixel i covers [i * dw, (i + 1) * dw) and destination pixel x covers
+// [x * sw, (x + 1) * sw) on the same integer axis, so every weight is an
+// exact overlap length and no floating point is needed.
+static inline void resampleArea565(const uint16_t *src, int sw, int sh, uint16_t *dst, int dw, int dh)
+{
+    uint32_t acc[PANEL_RES_X * 3];
+    const uint32_t total = (uint32_t)sw * sh;
+
+    for (int y = 0; y < dh; ++y)
+    {
+        memset(acc, 0, dw * 3 * sizeof(uint32_t));
+
+        int y0 = y * sh;
+        int y1 = y0 + sh;
+        for (int sy = y0 / dh; sy * dh < y1; ++sy)
+        {
+            int top = sy * dh > y0 ? sy * dh : y0;
+            int bottom = (sy + 1) * dh < y1 ? (sy + 1) * dh : y1;
+            uint32_t wy = bottom - top;
+            const uint16_t *row = &src[sy * sw];
+
+            for (int x = 0; x < dw; ++x)
+            {
+                int x0 = x * sw;
+                int x1 = x0 + sw;
+                uint32_t r = 0, g = 0, b = 0;
+                for (int sx = x0 / dw; sx * dw < x1; ++sx)
+                {
+                    int left = sx * dw > x0 ? sx * dw : x0;
+                    int right = (sx + 1) * dw < x1 ? (sx + 1) * dw : x1;
+                    uint32_t wx = right - left;
+                    uint16_t c = row[sx];
+                    r += (c >> 11) * wx;
+                    g += ((c >> 5) & 0x3F) * wx;
+                    b += (c & 0x1F) * wx;
+                }
+                acc[x * 3] += r * wy;
+                acc[x * 3 + 1] += g * wy;
+                acc[x * 3 + 2] += b * wy;
+            }
+        }
+
+        for (int x = 0; x < dw; ++x)
+        {
+            uint16_t r = (acc[x * 3] + total / 2) / total;
+            uint16_t g = (acc[x * 3 + 1] + total / 2) / total;
+            uint16_t b = (acc[x * 3 + 2] + total / 2) / total;
+            dst[y * dw + x] = (r << 11) | (g << 5) | b;
+        }
+    }
+}
+
+// Largest JPEGDEC reduction (1, 2, 4 or 8) that still leaves at least
+// target pixels, so the resampler only ever shrinks
+static inline int jpegScaleFor(int size, int target)
+{
+    int scale = 8;
+    while (scale > 1 && size / scale < target)
+        scale /= 2;
+    return scale;
+}
+
+// Picks which of Spotify's album images to fetch from measured download and
+// decode time. The preferred size is used while it fits the latency budget;
+// otherwise the next smaller one, with the preferred size re-probed every few
+// tracks in case the network got faster.
+class ArtSelector
+{
+public:
+    struct Cost
+    {
+        uint32_t downloadMs = 0; // moving averages
+        uint32_t decodeMs = 0;
+        uint32_t bytes = 0;
+        uint16_t samples = 0;
+
+        uint32_t totalMs() const { return downloadMs + decodeMs; }
+    };
+
+    int choose(int imageCount)
+    {
+        tracks++;
+        int last = imageCount - 1;
+        int index = CONFIG_ART_PREFERRED_INDEX < last ? CONFIG_ART_PREFERRED_INDEX : last;
+
+        for (; index < last; ++index)
+        {
+            const Cost &c = costs[index];
+            bool reprobe = tracks % CONFIG_ART_REPROBE_TRACKS == 0;
+            if (c.samples == 0 || reprobe || c.totalMs() <= CONFIG_ART_LATENCY_BUDGET_MS)
+                break;
+        }
+        return index < 0 ? 0 : index;
+    }
+
+    void record(int index, uint32_t downloadMs, uint32_t decodeMs, uint32_t bytes)
+    {
+        if (index < 0 || index >= ART_IMAGE_COUNT)
+            return;
+
+        Cost &c = costs[index];
+        if (c.samples == 0)
+        {
+            c.downloadMs = downloadMs;
+            c.decodeMs = decodeMs;
+            c.bytes = bytes;
+        }
+        else
+        {
+            // 1/4 weight for the new sample
+            c.downloadMs = (c.downloadMs * 3 + downloadMs) / 4;
+            c.decodeMs = (c.decodeMs * 3 + decodeMs) / 4;
+            c.bytes = (c.bytes * 3 + bytes) / 4;
+        }
+        if (c.samples < UINT16_MAX)
+            c.samples++;
+    }
+
+    // A failed download or decode (timeout, out of memory) counts as over
+    // budget, so choose() moves on to the next smaller size
+    void recordFailure(int index)
+    {
+        if (index < 0 || index >= ART_IMAGE_COUNT)
+            return;
+
+        Cost &c = costs[index];
+        if (c.totalMs() <= CONFIG_ART_LATENCY_BUDGET_MS)
+            c.downloadMs = CONFIG_ART_LATENCY_BUDGET_MS + 1 - c.decodeMs;
+        if (c.samples < UINT16_MAX)
+            c.samples++;
+    }
+
+    const Cost &cost(int index) const { return costs[index]; }
+
+private:
+    Cost costs[ART_IMAGE_COUNT];
+    uint32_t tracks = 0;
+};
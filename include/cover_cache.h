@@ -0,0 +1,173 @@
+// Compact run-length/index coding of decoded RGB565 covers for the flash cache
+#pragma once
+
+#include <config.h>
+#include <Arduino.h>
+
+#define COVER_CACHE_MAGIC 0x31525643 // "CVR1"
+
+// Byte codes, in the spirit of QOI but on RGB565 pixels:
+//   00rrrrrr  run of 1..64 copies of the previous pixel
+//   01iiiiii  pixel from the 64 entry table of recently seen colors
+//   10rrggbb  previous pixel plus -2..1 on each channel
+//   11nnnnnn  1..64 literal pixels follow, little endian
+#define RLE565_OP_RUN 0x00
+#define RLE565_OP_INDEX 0x40
+#define RLE565_OP_DIFF 0x80
+#define RLE565_OP_LITERAL 0xC0
+
+// Worst case is all literals: one code byte per 64 pixels
+#define RLE565_MAX_SIZE(pixels) ((pixels) * 2 + ((pixels) + 63) / 64)
+
+struct CoverCacheHeader
+{
+    uint32_t magic;
+    uint32_t key; // hash of the cover URL
+    uint16_t width;
+    uint16_t height;
+    uint32_t size; // encoded bytes after the header
+};
+
+static inline uint32_t coverCacheKey(const char *url)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    while (*url)
+    {
+        hash ^= (uint8_t)*url++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static inline uint8_t rle565Hash(uint16_t c)
+{
+    return ((c >> 11) * 3 + ((c >> 5) & 0x3F) * 5 + (c & 0x1F) * 7) & 0x3F;
+}
+
+// Returns the encoded size; dst must hold RLE565_MAX_SIZE(count) bytes
+static inline size_t rle565Encode(const uint16_t *src, size_t count, uint8_t *dst)
+{
+    uint16_t table[64] = {0};
+    uint16_t prev = 0;
+    size_t out = 0;
+    size_t run = 0;
+    size_t literalStart = 0; // position of the open literal code byte
+    size_t literals = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint16_t px = src[i];
+
+        if (px == prev)
+        {
+            literals = 0;
+            if (++run == 64)
+            {
+                dst[out++] = RLE565_OP_RUN | (run - 1);
+                run = 0;
+            }
+            continue;
+        }
+
+        if (run > 0)
+        {
+            dst[out++] = RLE565_OP_RUN | (run - 1);
+            run = 0;
+        }
+
+        uint8_t h = rle565Hash(px);
+        int dr = (px >> 11) - (prev >> 11);
+        int dg = ((px >> 5) & 0x3F) - ((prev >> 5) & 0x3F);
+        int db = (px & 0x1F) - (prev & 0x1F);
+
+        if (table[h] == px)
+        {
+            literals = 0;
+            dst[out++] = RLE565_OP_INDEX | h;
+        }
+        else if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+        {
+            literals = 0;
+            dst[out++] = RLE565_OP_DIFF | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2);
+        }
+        else
+        {
+            if (literals == 0 || literals == 64)
+            {
+                literalStart = out++;
+                literals = 0;
+            }
+            dst[literalStart] = RLE565_OP_LITERAL | literals;
+            dst[out++] = px & 0xFF;
+            dst[out++] = px >> 8;
+            literals++;
+        }
+
+        table[h] = px;
+        prev = px;
+    }
+
+    if (run > 0)
+        dst[out++] = RLE565_OP_RUN | (run - 1);
+    return out;
+}
+
+// Returns false if the data is truncated or does not fill exactly count pixels
+static inline bool rle565Decode(const uint8_t *src, size_t size, uint16_t *dst, size_t count)
+{
+    uint16_t table[64] = {0};
+    uint16_t prev = 0;
+    size_t in = 0;
+    size_t i = 0;
+
+    while (in < size && i < count)
+    {
+        uint8_t op = src[in++];
+        uint8_t arg = op & 0x3F;
+
+        switch (op & 0xC0)
+        {
+        case RLE565_OP_RUN:
+            if (i + arg + 1 > count)
+                return false;
+            for (int n = 0; n <= arg; ++n)
+                dst[i++] = prev;
+            continue;
+
+        case RLE565_OP_INDEX:
+            prev = table[arg];
+            dst[i++] = prev;
+            break;
+
+        case RLE565_OP_DIFF:
+        {
+            int r = (prev >> 11) + ((arg >> 4) & 3) - 2;
+            int g = ((prev >> 5) & 0x3F) + ((arg >> 2) & 3) - 2;
+            int b = (prev & 0x1F) + (arg & 3) - 2;
+            prev = (uint16_t)(((r & 0x1F) << 11) | ((g & 0x3F) << 5) | (b & 0x1F));
+            dst[i++] = prev;
+            break;
+        }
+
+        default: // RLE565_OP_LITERAL
+            if (in + (arg + 1) * 2 > size || i + arg + 1 > count)
+                return false;
+            for (int n = 0; n < arg; ++n)
+            {
+                uint16_t px = src[in] | (src[in + 1] << 8);
+                in += 2;
+                table[rle565Hash(px)] = px;
+                dst[i++] = px;
+            }
+            prev = src[in] | (src[in + 1] << 8);
+            in += 2;
+            dst[i++] = prev;
+            break;
+        }
+
+        table[rle565Hash(prev)] = prev;
+    }
+
+    return in == size && i == count;
+}
@@ -0,0 +1,180 @@
+// Compile-time filtered logging through a binary ring drained by a low priority task
+#pragma once
+
+#include <config.h>
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/ringbuf.h>
+#include <type_traits>
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef CONFIG_LOG_LEVEL
+#define CONFIG_LOG_LEVEL LOG_LEVEL_INFO
+#endif
+#ifndef CONFIG_LOG_BINARY
+#define CONFIG_LOG_BINARY 0 // 1 = raw records on USBSerial, read them with tools/log_decode.py
+#endif
+#ifndef CONFIG_LOG_RING_SIZE
+#define CONFIG_LOG_RING_SIZE 4096
+#endif
+
+#define LOG_MAX_ARGS 8
+#define LOG_MAX_STRING_BYTES 96 // all %s arguments of one record together
+#define LOG_SYNC 0xA5
+
+// Enabled levels write a record; disabled ones sit behind if (0), so their
+// arguments are still type checked but never evaluated and the compiler
+// drops the call entirely. Both pass the arguments to logCheckFormat() in
+// dead code, which restores printf's -Wformat checks.
+#define LOG_WRITE(level, format, ...)              \
+    do                                             \
+    {                                              \
+        if (0)                                     \
+            logCheckFormat(format, ##__VA_ARGS__); \
+        logWrite(level, format, ##__VA_ARGS__);    \
+    } while (0)
+
+#define LOG_DISCARD(level, format, ...)                \
+    do                                                 \
+    {                                                  \
+        if (0)                                         \
+        {                                              \
+            logCheckFormat(format, ##__VA_ARGS__);     \
+            logWrite(level, format, ##__VA_ARGS__);    \
+        }                                              \
+    } while (0)
+
+#if CONFIG_LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_E(format, ...) LOG_WRITE(LOG_LEVEL_ERROR, format, ##__VA_ARGS__)
+#else
+#define LOG_E(format, ...) LOG_DISCARD(LOG_LEVEL_ERROR, format, ##__VA_ARGS__)
+#endif
+
+#if CONFIG_LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_W(format, ...) LOG_WRITE(LOG_LEVEL_WARN, format, ##__VA_ARGS__)
+#else
+#define LOG_W(format, ...) LOG_DISCARD(LOG_LEVEL_WARN, format, ##__VA_ARGS__)
+#endif
+
+#if CONFIG_LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_I(format, ...) LOG_WRITE(LOG_LEVEL_INFO, format, ##__VA_ARGS__)
+#else
+#define LOG_I(format, ...) LOG_DISCARD(LOG_LEVEL_INFO, format, ##__VA_ARGS__)
+#endif
+
+#if CONFIG_LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_D(format, ...) LOG_WRITE(LOG_LEVEL_DEBUG, format, ##__VA_ARGS__)
+#else
+#define LOG_D(format, ...) LOG_DISCARD(LOG_LEVEL_DEBUG, format, ##__VA_ARGS__)
+#endif
+
+// Never called, only there for the format attribute
+static inline void logCheckFormat(const char *format, ...) __attribute__((format(printf, 1, 2)));
+static inline void logCheckFormat(const char *, ...) {}
+
+// A record is the address of the format string (it stays in flash, the host
+// decoder looks it up in firmware.elf), a timestamp and the raw arguments.
+// Integers are stored as 32-bit words; %s arguments are copied in after them.
+struct __attribute__((packed)) LogHeader
+{
+    uint32_t format;
+    uint32_t ms;
+    uint8_t level;
+    uint8_t argCount;
+    uint8_t stringMask; // bit n set: argument n is a string
+    uint8_t stringBytes;
+};
+
+struct LogArgs
+{
+    uint32_t words[LOG_MAX_ARGS];
+    char strings[LOG_MAX_STRING_BYTES];
+    uint8_t count = 0;
+    uint8_t stringMask = 0;
+    uint8_t stringBytes = 0;
+
+    void push(uint32_t word)
+    {
+        if (count < LOG_MAX_ARGS)
+            words[count++] = word;
+    }
+
+    void pushString(const char *s)
+    {
+        size_t room = LOG_MAX_STRING_BYTES - stringBytes;
+        if (count >= LOG_MAX_ARGS || room == 0 || s == nullptr)
+        {
+            push(0); // formats as "(null)"
+            return;
+        }
+
+        size_t n = strnlen(s, room - 1);
+        memcpy(&strings[stringBytes], s, n);
+        strings[stringBytes + n] = '\0';
+        stringBytes += n + 1;
+        stringMask |= 1 << count;
+        push(0);
+    }
+};
+
+static inline void logAdd(LogArgs &args, const char *s) { args.pushString(s); }
+static inline void logAdd(LogArgs &args, char *s) { args.pushString(s); }
+
+template <typename T>
+static inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type logAdd(LogArgs &args, T value)
+{
+    static_assert(sizeof(T) <= sizeof(uint32_t), "log arguments are 32-bit words");
+    args.push((uint32_t)value);
+}
+
+template <typename T>
+static inline typename std::enable_if<std::is_floating_point<T>::value>::type logAdd(LogArgs &, T)
+{
+    static_assert(!std::is_floating_point<T>::value, "log floats as scaled integers");
+}
+
+static inline void logCapture(LogArgs &) {}
+
+template <typename T, typename... Rest>
+static inline void logCapture(LogArgs &args, const T &value, const Rest &...rest)
+{
+    logAdd(args, value);
+    logCapture(args, rest...);
+}
+
+// Defined once in src/log.cpp
+extern RingbufHandle_t logRing;
+extern volatile uint32_t logDropped;
+
+// Creates the ring and the task that drains it to USBSerial. Call right
+// after USBSerial.begin(); records logged before are dropped.
+bool logBegin();
+
+static inline size_t logPack(uint8_t *record, uint8_t level, const char *format, uint32_t ms, const LogArgs &args)
+{
+    LogHeader header = {(uint32_t)(uintptr_t)format, ms, level, args.count, args.stringMask, args.stringBytes};
+    memcpy(record, &header, sizeof(header));
+    size_t size = sizeof(header);
+    memcpy(&record[size], args.words, args.count * sizeof(uint32_t));
+    size += args.count * sizeof(uint32_t);
+    memcpy(&record[size], args.strings, args.stringBytes);
+    return size + args.stringBytes;
+}
+
+// Never blocks: a full ring drops the record and counts it
+template <typename... Args>
+static inline void logWrite(uint8_t level, const char *format, const Args &...values)
+{
+    LogArgs args;
+    logCapture(args, values...);
+
+    uint8_t record[sizeof(LogHeader) + LOG_MAX_ARGS * sizeof(uint32_t) + LOG_MAX_STRING_BYTES];
+    size_t size = logPack(record, level, format, millis(), args);
+    if (logRing == nullptr || xRingbufferSend(logRing, record, size, 0) != pdTRUE)
+        logDropped++;
+}
@@ -0,0 +1,293 @@
+// Pre-rendered scrolling track/artist line drawn over the cover
+#pragma once
+
+#include <config.h>
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+
+#ifndef CONFIG_MARQUEE_STEP_MS
+#define CONFIG_MARQUEE_STEP_MS 50 // one pixel per step, 20 px/s
+#endif
+
+#define MARQUEE_MAX_WIDTH 1024 // longer text is cut, keeps the strip under 1KB
+#define MARQUEE_GAP 16         // blank pixels between the end and the restart
+
+// Small GFX fonts only have printable ASCII. Latin-1 letters fall back to their base
+// letter and the rest of U+00A0..U+00FF to the closest ASCII glyph.
+static const char latin1Fallback[] =
+    " !cL*Y|S\"ca<--r-"
+    "o+23'uP.,1o>????"
+    "AAAAAAACEEEEIIII"
+    "DNOOOOOxOUUUUYPs"
+    "aaaaaaaceeeeiiii"
+    "dnooooo/ouuuuypy";
+
+// Returns 0 when there is no single ASCII stand-in for cp
+static inline char fallbackGlyph(uint32_t cp)
+{
+    if (cp >= 0x20 && cp < 0x7F)
+        return (char)cp;
+    if (cp >= 0xA0 && cp <= 0xFF)
+        return latin1Fallback[cp - 0xA0];
+
+    switch (cp)
+    {
+    case 0x2018:
+    case 0x2019:
+        return '\'';
+    case 0x201C:
+    case 0x201D:
+        return '"';
+    case 0x2010:
+    case 0x2013:
+    case 0x2014:
+        return '-';
+    case 0x2022:
+        return '*';
+    case 0x2026:
+        return '.';
+    default:
+        return 0;
+    }
+}
+
+// Greek and Cyrillic titles are spelled out in Latin letters (simplified
+// ISO 843 and BGN romanization). Indexed from U+0391/U+03B1 and U+0410/U+0430;
+// lower case letters use the same entries lowered.
+static const char *const greekLatin[25] = {
+    "A", "V", "G", "D", "E", "Z", "I", "Th", "I", "K", "L", "M", "N",
+    "X", "O", "P", "R", "S", "S", "T", "Y", "F", "Ch", "Ps", "O"};
+
+static const char *const cyrillicLatin[32] = {
+    "A", "B", "V", "G", "D", "E", "Zh", "Z", "I", "Y", "K", "L", "M", "N", "O", "P",
+    "R", "S", "T", "U", "F", "Kh", "Ts", "Ch", "Sh", "Shch", "'", "Y", "'", "E", "Yu", "Ya"};
+
+struct LatinSpelling
+{
+    uint16_t cp;
+    uint16_t base; // letter of the tables above, or 0 to use latin
+    const char *latin;
+};
+
+// Accented Greek vowels and the Cyrillic letters outside U+0410..U+044F
+static const LatinSpelling extraSpellings[] = {
+    {0x0386, 0x0391, nullptr}, {0x0388, 0x0395, nullptr}, {0x0389, 0x0397, nullptr},
+    {0x038A, 0x0399, nullptr}, {0x038C, 0x039F, nullptr}, {0x038E, 0x03A5, nullptr},
+    {0x038F, 0x03A9, nullptr}, {0x0390, 0x03B9, nullptr}, {0x03AA, 0x0399, nullptr},
+    {0x03AB, 0x03A5, nullptr}, {0x03AC, 0x03B1, nullptr}, {0x03AD, 0x03B5, nullptr},
+    {0x03AE, 0x03B7, nullptr}, {0x03AF, 0x03B9, nullptr}, {0x03B0, 0x03C5, nullptr},
+    {0x03CA, 0x03B9, nullptr}, {0x03CB, 0x03C5, nullptr}, {0x03CC, 0x03BF, nullptr},
+    {0x03CD, 0x03C5, nullptr}, {0x03CE, 0x03C9, nullptr},
+    {0x0401, 0, "Yo"}, {0x0451, 0, "yo"}, {0x0404, 0, "Ye"}, {0x0454, 0, "ye"},
+    {0x0406, 0, "I"}, {0x0456, 0, "i"}, {0x0407, 0, "Yi"}, {0x0457, 0, "yi"},
+    {0x0490, 0, "G"}, {0x0491, 0, "g"}};
+
+// Appends the Latin spelling of a Greek or Cyrillic letter; false for others
+static inline bool appendLatinSpelling(String &out, uint32_t cp)
+{
+    const char *latin = nullptr;
+    for (const LatinSpelling &extra : extraSpellings)
+    {
+        if (extra.cp == cp)
+        {
+            latin = extra.latin;
+            cp = extra.base;
+            break;
+        }
+    }
+
+    bool lower = (cp >= 0x03B1 && cp <= 0x03C9) || (cp >= 0x0430 && cp <= 0x044F);
+    if (latin == nullptr)
+    {
+        if (cp >= 0x0391 && cp <= 0x03C9 && cp != 0x03A2 && (cp <= 0x03A9 || cp >= 0x03B1))
+            latin = greekLatin[lower ? cp - 0x03B1 : cp - 0x0391];
+        else if (cp >= 0x0410 && cp <= 0x044F)
+            latin = cyrillicLatin[lower ? cp - 0x0430 : cp - 0x0410];
+        else
+            return false;
+    }
+
+    for (; *latin; ++latin)
+        out += lower ? (char)tolower(*latin) : *latin;
+    return true;
+}
+
+// Combining accents, zero width spaces/joiners, direction marks, variation
+// selectors and the BOM draw nothing
+static inline bool isInvisible(uint32_t cp)
+{
+    return (cp >= 0x0300 && cp <= 0x036F) || (cp >= 0x200B && cp <= 0x200F) ||
+           (cp >= 0xFE00 && cp <= 0xFE0F) || cp == 0xFEFF;
+}
+
+// Decodes UTF-8 into the ASCII glyphs the font can draw. Scripts without a
+// spelling (CJK, emoji, ...) and malformed bytes become a single '?' per run
+// instead of a line of them.
+static inline String toPanelText(const char *utf8)
+{
+    String out;
+    bool unknownRun = false;
+    const uint8_t *p = (const uint8_t *)utf8;
+    while (*p)
+    {
+        uint32_t cp;
+        int extra;
+        if (*p < 0x80)
+        {
+            cp = *p;
+            extra = 0;
+        }
+        else if ((*p & 0xE0) == 0xC0)
+        {
+            cp = *p & 0x1F;
+            extra = 1;
+        }
+        else if ((*p & 0xF0) == 0xE0)
+        {
+            cp = *p & 0x0F;
+            extra = 2;
+        }
+        else if ((*p & 0xF8) == 0xF0)
+        {
+            cp = *p & 0x07;
+            extra = 3;
+        }
+        else
+        {
+            cp = 0;
+            extra = -1; // stray continuation or invalid lead byte
+        }
+
+        ++p;
+        for (; extra > 0 && (*p & 0xC0) == 0x80; --extra, ++p)
+            cp = (cp << 6) | (*p & 0x3F);
+
+        if (extra == 0 && isInvisible(cp))
+            continue;
+
+        char glyph = extra == 0 ? fallbackGlyph(cp) : 0;
+        if (glyph != 0)
+        {
+            out += glyph;
+            unknownRun = false;
+        }
+        else if (extra == 0 && appendLatinSpelling(out, cp))
+        {
+            unknownRun = false;
+        }
+        else if (!unknownRun)
+        {
+            out += '?';
+            unknownRun = true;
+        }
+    }
+    return out;
+}
+
+class Marquee
+{
+public:
+    static const int height = 7; // Picopixel line height
+    static const int width = PANEL_RES_X;
+
+    explicit Marquee(const GFXfont *stripFont) : font(stripFont) {}
+
+    uint16_t textColor = 0xFFFF;
+    uint16_t backdropColor = 0x0841; // near black, but not the transparent key
+
+    // Rasterizes the text once; frames then only copy a window of the strip
+    bool setText(const char *utf8)
+    {
+        String text = toPanelText(utf8);
+
+        int textWidth = 0;
+        for (unsigned int i = 0; i < text.length(); ++i)
+        {
+            uint8_t c = text[i];
+            if (c >= font->first && c <= font->last)
+                textWidth += font->glyph[c - font->first].xAdvance;
+        }
+        if (textWidth > MARQUEE_MAX_WIDTH)
+            textWidth = MARQUEE_MAX_WIDTH;
+
+        scrolling = textWidth > width;
+        int newWidth = scrolling ? textWidth + MARQUEE_GAP : width;
+
+        delete strip;
+        strip = new GFXcanvas1(newWidth, height);
+        if (strip->getBuffer() == nullptr)
+        {
+            delete strip;
+            strip = nullptr;
+            return false;
+        }
+
+        stripWidth = newWidth;
+        strip->fillScreen(0);
+        strip->setFont(font);
+        strip->setTextWrap(false);
+        strip->setTextColor(1);
+        strip->setCursor(scrolling ? 0 : (width - textWidth) / 2, 5);
+        strip->print(text);
+
+        offset = 0;
+        changed = true;
+        return true;
+    }
+
+    // Draws the visible window into rows [y, y + height) of layer when the
+    // text changed or a scroll step is due; returns true if it drew
+    bool tick(GFXcanvas16 &layer, int y, unsigned long now)
+    {
+        if (strip == nullptr)
+            return false;
+
+        if (scrolling && now - lastStep >= CONFIG_MARQUEE_STEP_MS)
+        {
+            lastStep = now;
+            offset = (offset + 1) % stripWidth;
+            changed = true;
+        }
+
+        if (!changed)
+            return false;
+        changed = false;
+
+        const uint8_t *bits = strip->getBuffer();
+        int bytesPerRow = (stripWidth + 7) / 8;
+        uint16_t *dst = &layer.getBuffer()[y * width];
+
+        for (int row = 0; row < height; ++row)
+        {
+            const uint8_t *src = &bits[row * bytesPerRow];
+            int sx = offset;
+            for (int x = 0; x < width; ++x)
+            {
+                bool on = src[sx >> 3] & (0x80 >> (sx & 7));
+                dst[row * width + x] = on ? textColor : backdropColor;
+                if (++sx == stripWidth)
+                    sx = 0;
+            }
+        }
+        return true;
+    }
+
+    // Milliseconds until the next scroll step, or limit if the text is static
+    unsigned long msUntilStep(unsigned long now, unsigned long limit) const
+    {
+        if (strip == nullptr || !scrolling)
+            return limit;
+        unsigned long elapsed = now - lastStep;
+        unsigned long wait = elapsed >= CONFIG_MARQUEE_STEP_MS ? 0 : CONFIG_MARQUEE_STEP_MS - elapsed;
+        return wait < limit ? wait : limit;
+    }
+
+private:
+    const GFXfont *font;
+    GFXcanvas1 *strip = nullptr;
+    int stripWidth = 0;
+    int offset = 0;
+    bool scrolling = false;
+    bool changed = false;
+    unsigned long lastStep = 0;
+};
@@ -0,0 +1,125 @@
+// Idle governor: lower CPU clock and deadline based sleeps between polls and frames
+#pragma once
+
+#include <config.h>
+#include <Arduino.h>
+
+#ifndef CONFIG_CPU_ACTIVE_MHZ
+#define CONFIG_CPU_ACTIVE_MHZ 240
+#endif
+#ifndef CONFIG_CPU_IDLE_MHZ
+#define CONFIG_CPU_IDLE_MHZ 80 // lowest clock that keeps APB at 80MHz for the HUB75 DMA
+#endif
+#ifndef CONFIG_WIFI_LISTEN_INTERVAL
+#define CONFIG_WIFI_LISTEN_INTERVAL 3 // beacon intervals the radio may sleep through
+#endif
+#ifndef CONFIG_POWER_REPORT_MS
+#define CONFIG_POWER_REPORT_MS 60000
+#endif
+
+// How long the loop may sleep: until the next poll, or sooner for the next
+// transition frame (frameInterval after the last one) while a transition
+// runs and for the next marquee step (stepWait, at least pollInterval when
+// nothing scrolls). While a poll is in flight the poll task wakes the loop
+// when it is done, so the poll does not shorten the sleep. Pure so
+// tools/host/schedule_sim.cpp can check it.
+static inline unsigned long msUntilNextDeadline(unsigned long now, unsigned long lastPoll, unsigned long pollInterval,
+                                                bool pollBusy, bool animating, unsigned long lastFrame,
+                                                unsigned long frameInterval, unsigned long stepWait)
+{
+    unsigned long sinceLastPoll = now - lastPoll;
+    unsigned long wait = pollBusy ? pollInterval : sinceLastPoll >= pollInterval ? 0 : pollInterval - sinceLastPoll;
+    if (animating)
+    {
+        unsigned long sinceLastFrame = now - lastFrame;
+        unsigned long frameWait = sinceLastFrame >= frameInterval ? 0 : frameInterval - sinceLastFrame;
+        if (frameWait < wait)
+            wait = frameWait;
+    }
+    if (stepWait < wait)
+        wait = stepWait;
+    return wait;
+}
+
+class PowerGovernor
+{
+public:
+    struct Metrics
+    {
+        uint64_t activeUs = 0;
+        uint64_t idleUs = 0;
+        uint32_t wakes = 0;
+        uint32_t wakeLatencySumUs = 0; // how late each sleep ended past its deadline
+        uint32_t wakeLatencyMaxUs = 0;
+        uint32_t missedDeadlines = 0; // woke more than a millisecond late
+
+        // Share of time awake, in tenths of a percent
+        uint32_t dutyPermille() const
+        {
+            uint64_t total = activeUs + idleUs;
+            return total == 0 ? 1000 : (uint32_t)(activeUs * 1000 / total);
+        }
+
+        uint32_t wakeLatencyAvgUs() const
+        {
+            return wakes == 0 ? 0 : wakeLatencySumUs / wakes;
+        }
+    };
+
+    void begin()
+    {
+        lastChange = micros();
+        setFrequency(CONFIG_CPU_ACTIVE_MHZ);
+    }
+
+    // Full clock for everything the loop does when it wakes: composing
+    // frames and turning poll results into layers
+    void active()
+    {
+        setFrequency(CONFIG_CPU_ACTIVE_MHZ);
+    }
+
+    // Drops the clock and blocks the loop task until ms from now, or until
+    // another task notifies it. keepClock stays at full speed for work on
+    // the other core (the clock is shared). The HUB75 DMA keeps refreshing
+    // the panel on its own while the CPU waits.
+    void idleFor(unsigned long ms, bool keepClock = false)
+    {
+        unsigned long start = micros();
+        metrics.activeUs += start - lastChange;
+
+        setFrequency(keepClock ? CONFIG_CPU_ACTIVE_MHZ : CONFIG_CPU_IDLE_MHZ);
+        if (ms > 0)
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ms));
+
+        unsigned long woke = micros();
+        uint32_t late = (woke - start) > ms * 1000UL ? (woke - start) - ms * 1000UL : 0;
+        metrics.idleUs += woke - start;
+        metrics.wakes++;
+        metrics.wakeLatencySumUs += late;
+        if (late > metrics.wakeLatencyMaxUs)
+            metrics.wakeLatencyMaxUs = late;
+        if (late > 1000)
+            metrics.missedDeadlines++;
+        lastChange = woke;
+    }
+
+    const Metrics &stats() const { return metrics; }
+
+    // Starts a new measurement window
+    void resetStats()
+    {
+        metrics = Metrics();
+    }
+
+private:
+    Metrics metrics;
+    unsigned long lastChange = 0;
+    uint32_t currentMhz = 0;
+
+    void setFrequency(uint32_t mhz)
+    {
+        if (mhz != currentMhz && setCpuFrequencyMhz(mhz))
+            currentMhz = mhz;
+    }
+};
@@ -0,0 +1,8 @@
+// Loop timing shared by src/main.cpp and tools/host/schedule_sim.cpp
+#pragma once
+
+#include <config.h>
+
+#define POLL_INTERVAL_MS 4000
+#define FRAME_INTERVAL_MS 16 // ~60 fps while a transition runs
+#define MARQUEE_Y (PANEL_RES_Y - 7) // track line sits on the bottom rows
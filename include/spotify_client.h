@@ -0,0 +1,241 @@
+// Rate-limit aware wrapper around the SpotifyEsp32 client
+#pragma once
+
+#include <config.h>
+#include <Arduino.h>
+#include <SpotifyEsp32.h>
+
+// Defaults for configs created before these settings existed
+#ifndef CONFIG_SPOTIFY_HOURLY_BUDGET
+#define CONFIG_SPOTIFY_HOURLY_BUDGET 900
+#endif
+#ifndef CONFIG_SPOTIFY_TOKEN_LIFETIME_S
+#define CONFIG_SPOTIFY_TOKEN_LIFETIME_S 3600
+#endif
+#ifndef CONFIG_SPOTIFY_TOKEN_REFRESH_MARGIN_S
+#define CONFIG_SPOTIFY_TOKEN_REFRESH_MARGIN_S 300
+#endif
+#ifndef CONFIG_SPOTIFY_RATE_LIMIT_WAIT_S
+#define CONFIG_SPOTIFY_RATE_LIMIT_WAIT_S 30
+#endif
+#ifndef CONFIG_SPOTIFY_BACKOFF_BASE_MS
+#define CONFIG_SPOTIFY_BACKOFF_BASE_MS 4000
+#endif
+#ifndef CONFIG_SPOTIFY_BACKOFF_MAX_MS
+#define CONFIG_SPOTIFY_BACKOFF_MAX_MS 120000
+#endif
+#ifndef CONFIG_SPOTIFY_BREAKER_THRESHOLD
+#define CONFIG_SPOTIFY_BREAKER_THRESHOLD 5
+#endif
+#ifndef CONFIG_SPOTIFY_BREAKER_COOLDOWN_MS
+#define CONFIG_SPOTIFY_BREAKER_COOLDOWN_MS 300000
+#endif
+
+class SpotifyClient
+{
+public:
+    enum class Result
+    {
+        Ok,      // 200 or 204, reply is usable
+        Skipped, // no request made (backoff, open breaker or budget spent)
+        Failed   // request made but the reply is not usable
+    };
+
+    enum class Breaker
+    {
+        Closed,
+        Open,
+        HalfOpen
+    };
+
+    struct Counters
+    {
+        uint32_t requests = 0;          // currently_playing calls sent
+        uint32_t tokenRefreshes = 0;    // access token refreshes (proactive + on 401)
+        uint32_t rateLimited = 0;       // 429 replies
+        uint32_t failures = 0;          // 401/403/5xx/timeouts
+        uint32_t skippedBackoff = 0;    // polls held back by a 429 wait or backoff
+        uint32_t skippedBreaker = 0;    // polls held back by the open breaker
+        uint32_t skippedBudget = 0;     // polls held back by the hourly budget
+        uint32_t retriesAvoided = 0;    // immediate re-requests the old loop would have made
+
+        uint32_t wastedCallsAvoided() const
+        {
+            return skippedBackoff + skippedBreaker + skippedBudget + retriesAvoided;
+        }
+    };
+
+    explicit SpotifyClient(Spotify &client) : sp(client) {}
+
+    // Timestamps are uint32_t because millis() is 32 bits on the ESP32; host
+    // builds then wrap the same way the device does (every ~49.7 days)
+
+    // Call once the library holds a fresh access token (after auth)
+    void markTokenRefreshed(uint32_t now)
+    {
+        tokenRefreshedAt = now;
+        tokenValid = true;
+    }
+
+    Result currentlyPlaying(response &out, uint32_t now)
+    {
+        rollBudgetWindow(now);
+
+        if (blockedMs != 0)
+        {
+            if (now - blockedFrom < blockedMs)
+            {
+                counters.skippedBackoff++;
+                return Result::Skipped;
+            }
+            blockedMs = 0; // over; never compared against a stale timestamp again
+        }
+
+        if (breaker == Breaker::Open)
+        {
+            if (now - breakerOpenedAt < CONFIG_SPOTIFY_BREAKER_COOLDOWN_MS)
+            {
+                counters.skippedBreaker++;
+                return Result::Skipped;
+            }
+            breaker = Breaker::HalfOpen; // let one probe through
+        }
+
+        if (requestsThisWindow >= CONFIG_SPOTIFY_HOURLY_BUDGET)
+        {
+            counters.skippedBudget++;
+            return Result::Skipped;
+        }
+
+        // Refresh ahead of expiry so polls never spend a request on a dead token
+        if (!tokenValid || now - tokenRefreshedAt >= (CONFIG_SPOTIFY_TOKEN_LIFETIME_S - CONFIG_SPOTIFY_TOKEN_REFRESH_MARGIN_S) * 1000UL)
+        {
+            if (!refreshToken(now))
+            {
+                counters.failures++;
+                recordFailure(now);
+                return Result::Failed;
+            }
+        }
+
+        out = sp.currently_playing();
+        counters.requests++;
+        requestsThisWindow++;
+
+        int code = out.status_code;
+        if (code == 200 || code == 204)
+        {
+            recordSuccess();
+            return Result::Ok;
+        }
+
+        if (code == 429)
+        {
+            // SpotifyEsp32 does not hand back response headers, so Retry-After
+            // cannot be read; wait a fixed time instead. Not counted against
+            // the breaker: the service is up, just asking us to slow down.
+            counters.rateLimited++;
+            blockFor(now, CONFIG_SPOTIFY_RATE_LIMIT_WAIT_S * 1000UL);
+            return Result::Failed;
+        }
+
+        if (code == 401)
+        {
+            // Refresh now, but leave the re-request to the next scheduled poll
+            tokenValid = false;
+            refreshToken(now);
+            counters.retriesAvoided++;
+        }
+        else if (isTimeout(out))
+        {
+            // No immediate re-request, backoff decides when to try again
+            counters.retriesAvoided++;
+        }
+
+        counters.failures++;
+        recordFailure(now);
+        return Result::Failed;
+    }
+
+    Breaker breakerState() const { return breaker; }
+    uint32_t requestsInWindow() const { return requestsThisWindow; }
+    const Counters &stats() const { return counters; }
+
+private:
+    Spotify &sp;
+    Counters counters;
+
+    // Waits are kept as start + length and checked as elapsed < length, which
+    // stays correct across millis() wrapping; an "until" timestamp compared
+    // with a signed difference flips sign ~24.9 days after it was set
+    Breaker breaker = Breaker::Closed;
+    uint32_t breakerOpenedAt = 0;
+    uint8_t consecutiveFailures = 0;
+    uint32_t blockedFrom = 0;
+    uint32_t blockedMs = 0; // 0 = not blocked
+
+    uint32_t windowStart = 0;
+    uint32_t requestsThisWindow = 0;
+
+    uint32_t tokenRefreshedAt = 0;
+    bool tokenValid = false;
+
+    static bool isTimeout(const response &r)
+    {
+        return r.status_code < 0 || r.reply["message"].as<String>().equals("Timeout receiving headers");
+    }
+
+    // Fixed one hour windows, not a rolling hour: the count restarts when
+    // the first poll after the window's hour is up opens a new one
+    void rollBudgetWindow(uint32_t now)
+    {
+        if (now - windowStart >= 3600000UL)
+        {
+            windowStart = now;
+            requestsThisWindow = 0;
+        }
+    }
+
+    bool refreshToken(uint32_t now)
+    {
+        counters.tokenRefreshes++;
+        if (sp.get_access_token())
+        {
+            markTokenRefreshed(now);
+            return true;
+        }
+        tokenValid = false;
+        return false;
+    }
+
+    void recordSuccess()
+    {
+        consecutiveFailures = 0;
+        breaker = Breaker::Closed;
+    }
+
+    void blockFor(uint32_t now, uint32_t ms)
+    {
+        blockedFrom = now;
+        blockedMs = ms;
+    }
+
+    void recordFailure(uint32_t now)
+    {
+        if (consecutiveFailures < 31)
+            consecutiveFailures++;
+
+        uint32_t backoff = CONFIG_SPOTIFY_BACKOFF_BASE_MS;
+        for (uint8_t i = 1; i < consecutiveFailures && backoff < CONFIG_SPOTIFY_BACKOFF_MAX_MS; ++i)
+            backoff *= 2;
+        if (backoff > CONFIG_SPOTIFY_BACKOFF_MAX_MS)
+            backoff = CONFIG_SPOTIFY_BACKOFF_MAX_MS;
+        blockFor(now, backoff);
+
+        if (breaker == Breaker::HalfOpen || consecutiveFailures >= CONFIG_SPOTIFY_BREAKER_THRESHOLD)
+        {
+            breaker = Breaker::Open;
+            breakerOpenedAt = now;
+        }
+    }
+};
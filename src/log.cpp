@@ -0,0 +1,76 @@
+// Log ring shared by every translation unit and the task that drains it
+#include <log.h>
+
+RingbufHandle_t logRing = nullptr;
+volatile uint32_t logDropped = 0;
+
+static void logEmit(const uint8_t *record, size_t size)
+{
+#if CONFIG_LOG_BINARY
+    uint8_t frame[2] = {LOG_SYNC, (uint8_t)size};
+    USBSerial.write(frame, sizeof(frame));
+    USBSerial.write(record, size);
+#else
+    (void)size;
+    LogHeader header;
+    memcpy(&header, record, sizeof(header));
+
+    uint32_t words[LOG_MAX_ARGS] = {0};
+    memcpy(words, &record[sizeof(header)], header.argCount * sizeof(uint32_t));
+
+    // Point string arguments at their copies inside the record
+    const char *s = (const char *)&record[sizeof(header) + header.argCount * sizeof(uint32_t)];
+    for (int i = 0; i < header.argCount; ++i)
+    {
+        if (header.stringMask & (1 << i))
+        {
+            words[i] = (uint32_t)(uintptr_t)s;
+            s += strlen(s) + 1;
+        }
+    }
+
+    // Every printf argument is one 32-bit word on the ESP32, so passing all
+    // slots works whatever the conversions are; unused ones are ignored
+    static const char levels[] = "-EWID";
+    char text[192];
+    snprintf(text, sizeof(text), (const char *)(uintptr_t)header.format,
+             words[0], words[1], words[2], words[3], words[4], words[5], words[6], words[7]);
+    USBSerial.printf("[%lu] %c %s\n", (unsigned long)header.ms, levels[header.level], text);
+#endif
+}
+
+static void logDrainTask(void *)
+{
+    uint32_t reportedDrops = 0;
+    for (;;)
+    {
+        size_t size;
+        uint8_t *record = (uint8_t *)xRingbufferReceive(logRing, &size, portMAX_DELAY);
+        if (record != nullptr)
+        {
+            logEmit(record, size);
+            vRingbufferReturnItem(logRing, record);
+        }
+
+        uint32_t dropped = logDropped;
+        if (dropped != reportedDrops)
+        {
+            LogArgs args;
+            args.push(dropped - reportedDrops);
+            uint8_t note[sizeof(LogHeader) + sizeof(uint32_t)];
+            size_t noteSize = logPack(note, LOG_LEVEL_WARN, "log: %u records dropped", millis(), args);
+            logEmit(note, noteSize);
+            reportedDrops = dropped;
+        }
+    }
+}
+
+bool logBegin()
+{
+    logRing = xRingbufferCreate(CONFIG_LOG_RING_SIZE, RINGBUF_TYPE_NOSPLIT);
+    if (logRing == nullptr)
+        return false;
+
+    // Below the Arduino loop task so USB writes only happen when it is idle
+    return xTaskCreate(logDrainTask, "log", 4096, nullptr, tskIDLE_PRIORITY, nullptr) == pdPASS;
+}
@@ -3,6 +3,7 @@
 #include <ESP32-HUB75-MatrixPanel-I2S-DMA.h>
 
 #include <WiFi.h>
+#include <esp_wifi.h>
 #include <SpotifyEsp32.h>
 #include "FS.h"
 #include <LittleFS.h>
@@ -14,17 +15,32 @@
 #include <Fonts/Picopixel.h>
 #include <Fonts/FreeSans12pt7b.h>
 
+#include <log.h>
 #include <color_tools.h>
+#include <spotify_client.h>
+#include <compositor.h>
+#include <cover_art.h>
+#include <cover_cache.h>
+#include <power_governor.h>
+#include <schedule.h>
+#ifdef ENABLE_MARQUEE
+#include <marquee.h>
+#endif
 
 #define countof(x) (sizeof(x) / sizeof(x[0]))
 #define SETUP_LOG_LINES 8
+#define COVER_CACHE_FILE "/cover.rle"
 
 // Function prototypes
 void drawClock(const String &clockText, uint16_t bodyColor, int yOffset = 39);
 bool hasInternetConnectivity();
+void setWifiPowerSave();
 void ensureSpotifyReady();
 void addSetupLog(const String &msg);
 void drawSetupLogs();
+void pollTask(void *);
+void pollSpotify();
+void updateScreen();
 
 #ifdef ENABLE_CALENDAR
 String fetchCalendar();
@@ -34,13 +50,59 @@ void drawCalendarLines(const String &calendarText, uint16_t bodyColor, int start
 #endif
 int downloadImage(const String &imageUrl);
 int drawMCU(JPEGDRAW *pDraw);
-void drawJPEG(const char *filename, int xpos, int ypos);
+bool drawJPEG(const char *filename);
+bool downloadCover(JsonArrayConst images);
+bool loadCoverCache(uint32_t key);
+void saveCoverCache(uint32_t key);
 
 // MatrixPanel_I2S_DMA dma_display;
 MatrixPanel_I2S_DMA *dma_display = nullptr;
 
+// Off-screen layers flattened by the compositor into the panel
+Compositor compositor;
+GFXcanvas16 *coverLayer = nullptr;
+GFXcanvas16 *clockLayer = nullptr;
+#ifdef ENABLE_CALENDAR
+GFXcanvas16 *calendarLayer = nullptr;
+#endif
+#ifdef ENABLE_MARQUEE
+GFXcanvas16 *overlayLayer = nullptr;
+Marquee marquee(&Picopixel);
+String currentTrackId = ""; // poll task
+#endif
+uint32_t coverScene = LAYER_BIT(LAYER_COVER);
+bool displayReady = false;
+unsigned long lastPoll = 0;
+bool firstPoll = true;
+
+// Network and decoding run in pollTask on the other core, so scrolling and
+// transitions never wait for them. loop() owns the compositor and every
+// layer; the poll task only fills pollOutcome and coverStaging. It starts
+// when loop() sets pollBusy and notifies it, and sets pollDone when it is
+// finished; loop() reads the outcome after that and only then clears
+// pollBusy, so the two never touch the outcome at the same time.
+struct PollOutcome
+{
+    bool authenticated = false;
+    bool playing = false;
+    bool trackChanged = false; // trackLine is a new marquee text
+    String trackLine;
+    bool coverChanged = false; // coverStaging holds a new cover
+    String calendar;
+};
+PollOutcome pollOutcome;
+uint16_t *coverStaging = nullptr; // decoded cover, copied into the cover layer by loop()
+volatile bool pollBusy = false;
+volatile bool pollDone = false;
+TaskHandle_t pollTaskHandle = nullptr;
+TaskHandle_t loopTaskHandle = nullptr;
+unsigned long lastFrame = 0; // when the last frame was pushed, transitions are paced from it
+PowerGovernor governor;
+unsigned long lastPowerReport = 0;
+
 String currentAlbumArtUrl = "";
 String previousAlbumArtUrl = " ";
+ArtSelector artSelector;
 bool isSpotifyPlaying = false;
 bool spotifyInitialized = false;
 bool spotifyAuthenticated = false;
@@ -52,8 +114,18 @@ String lastCalendarResponse = "";
 #endif
 
 Spotify sp(CLIENT_ID, CLIENT_SECRET, REFRESH_TOKEN, true);
+SpotifyClient spotifyClient(sp);
 JPEGDEC jpeg;
 
+// Where drawMCU copies decoded pixels: coverStaging, or a scratch buffer
+// when the decoded image still has to be resampled down to the panel
+struct DecodeTarget
+{
+    uint16_t *pixels;
+    int width;
+    int height;
+} decodeTarget;
+
 struct tm timeinfo;
 
 #ifdef ENABLE_CALENDAR
@@ -62,18 +134,18 @@ String fetchCalendar()
     HTTPClient http;
     String response = "";
 
-    USBSerial.println(F("Fetching calendar..."));
+    LOG_I("Fetching calendar...");
     http.begin(CALENDAR_URL);
 
     int httpCode = http.GET();
     if (httpCode == HTTP_CODE_OK)
     {
         response = http.getString();
-        USBSerial.println("Calendar response: " + response);
+        LOG_D("Calendar response: %s", response.c_str());
     }
     else
     {
-        USBSerial.println("[HTTP] Calendar GET failed, error: " + http.errorToString(httpCode) + " : " + String(httpCode));
+        LOG_W("[HTTP] Calendar GET failed, error: %s : %d", http.errorToString(httpCode).c_str(), httpCode);
     }
 
     http.end();
@@ -112,10 +184,10 @@ int countLines(const String &text)
 
 void drawCalendarLines(const String &calendarText, uint16_t bodyColor, int startY, int lineHeight)
 {
-    dma_display->setTextSize(1);
-    dma_display->setTextWrap(false);
-    dma_display->setFont(&Picopixel);
-    dma_display->setTextColor(bodyColor);
+    calendarLayer->setTextSize(1);
+    calendarLayer->setTextWrap(false);
+    calendarLayer->setFont(&Picopixel);
+    calendarLayer->setTextColor(bodyColor);
 
     int cursorY = startY;
     int start = 0;
@@ -124,8 +196,8 @@ void drawCalendarLines(const String &calendarText, uint16_t bodyColor, int start
         int nl = calendarText.indexOf('\n', start);
         String line = (nl == -1) ? calendarText.substring(start) : calendarText.substring(start, nl);
 
-        dma_display->setCursor(1, cursorY);
-        dma_display->printf("%s", line.c_str());
+        calendarLayer->setCursor(1, cursorY);
+        calendarLayer->printf("%s", line.c_str());
 
         if (nl == -1)
             break;
@@ -139,13 +211,13 @@ void drawClock(const String &clockText, uint16_t bodyColor, int yOffset)
 {
     int xOffset = 3;
 
-    dma_display->setTextSize(1);
-    dma_display->setTextWrap(false);
-    dma_display->setFont(&FreeSans12pt7b);
+    clockLayer->setTextSize(1);
+    clockLayer->setTextWrap(false);
+    clockLayer->setFont(&FreeSans12pt7b);
 
-    dma_display->setCursor(xOffset, yOffset);
-    dma_display->setTextColor(bodyColor);
-    dma_display->printf("%s", clockText.c_str());
+    clockLayer->setCursor(xOffset, yOffset);
+    clockLayer->setTextColor(bodyColor);
+    clockLayer->printf("%s", clockText.c_str());
 }
 
 bool hasInternetConnectivity()
@@ -157,7 +229,7 @@ bool hasInternetConnectivity()
     // Lightweight connectivity check endpoint
     if (!http.begin("http://clients3.google.com/generate_204"))
     {
-        USBSerial.println(F("Connectivity check begin failed"));
+        LOG_W("Connectivity check begin failed");
         return false;
     }
 
@@ -166,15 +238,53 @@ bool hasInternetConnectivity()
     bool ok = code == 204;
     if (ok)
     {
-        USBSerial.println(F("Internet reachable"));
+        LOG_D("Internet reachable");
     }
     else
     {
-        USBSerial.println("No internet, code: " + String(code));
+        LOG_W("No internet, code: %d", code);
     }
     return ok;
 }
 
+// Max modem sleep: the radio wakes every CONFIG_WIFI_LISTEN_INTERVAL beacons
+// instead of every DTIM (min modem, the Arduino default). The AP buffers
+// frames for that long, which only adds latency to the poll every 4 seconds.
+void setWifiPowerSave()
+{
+    WiFi.setSleep(WIFI_PS_MAX_MODEM);
+
+    // The listen interval is sent to the AP when associating, so a change
+    // only takes effect after reconnecting
+    wifi_config_t conf;
+    if (esp_wifi_get_config(WIFI_IF_STA, &conf) != ESP_OK)
+    {
+        LOG_W("WiFi listen interval: cannot read config");
+        return;
+    }
+    uint16_t current = conf.sta.listen_interval ? conf.sta.listen_interval : 3; // 0 means the driver default of 3
+    if (current == CONFIG_WIFI_LISTEN_INTERVAL)
+    {
+        LOG_I("WiFi power save: max modem, listen interval %u", (unsigned)current);
+        return;
+    }
+
+    conf.sta.listen_interval = CONFIG_WIFI_LISTEN_INTERVAL;
+    if (esp_wifi_set_config(WIFI_IF_STA, &conf) != ESP_OK)
+    {
+        LOG_W("WiFi listen interval: cannot set %u", (unsigned)CONFIG_WIFI_LISTEN_INTERVAL);
+        return;
+    }
+    WiFi.reconnect();
+    unsigned long start = millis();
+    while (WiFi.status() != WL_CONNECTED && millis() - start < 10000)
+    {
+        delay(100);
+    }
+    LOG_I("WiFi power save: max modem, listen interval %u%s", (unsigned)CONFIG_WIFI_LISTEN_INTERVAL,
+          WiFi.status() == WL_CONNECTED ? "" : " (reconnect pending)");
+}
+
 void ensureSpotifyReady()
 {
     if (spotifyAuthenticated)
@@ -182,28 +292,27 @@ void ensureSpotifyReady()
 
     if (WiFi.status() != WL_CONNECTED)
     {
-        USBSerial.println(F("WiFi lost, cannot init Spotify"));
+        LOG_W("WiFi lost, cannot init Spotify");
         spotifyInitialized = false;
         return;
     }
 
     if (!hasInternetConnectivity())
     {
-        USBSerial.println(F("No internet, deferring Spotify auth"));
+        LOG_W("No internet, deferring Spotify auth");
         return;
     }
 
     if (!spotifyInitialized)
     {
-        USBSerial.print(F("Spotify begin: "));
         sp.begin();
         spotifyInitialized = true;
-        USBSerial.println(F("started"));
+        LOG_I("Spotify begin: started");
     }
 
     if (!sp.is_auth())
     {
-        USBSerial.print(F("Authenticating Spotify (timeout 10s): "));
+        LOG_I("Authenticating Spotify (timeout 10s)");
         unsigned long start = millis();
         while (!sp.is_auth() && millis() - start < 10000)
         {
@@ -213,17 +322,19 @@ void ensureSpotifyReady()
         if (sp.is_auth())
         {
             spotifyAuthenticated = true;
-            USBSerial.printf("Authenticated! Refresh token: %s\n", sp.get_user_tokens().refresh_token);
+            spotifyClient.markTokenRefreshed(millis());
+            LOG_I("Authenticated! Refresh token: %s", sp.get_user_tokens().refresh_token);
         }
         else
         {
-            USBSerial.println(F("Auth not completed, will retry later"));
+            LOG_W("Auth not completed, will retry later");
         }
     }
     else
     {
         spotifyAuthenticated = true;
-        USBSerial.println(F("Spotify already authenticated"));
+        spotifyClient.markTokenRefreshed(millis());
+        LOG_I("Spotify already authenticated");
     }
 }
 
@@ -268,14 +379,14 @@ void drawSetupLogs()
 
 int downloadImage(const String &imageUrl)
 {
-    USBSerial.println("Downloading image... " + imageUrl);
+    LOG_I("Downloading image... %s", imageUrl.c_str());
     HTTPClient http;
 
     File f = LittleFS.open("/cover.jpg", "w");
 
     if (!f)
     {
-        USBSerial.println("Error opening file");
+        LOG_E("Error opening file");
         return -1;
     }
 
@@ -285,82 +396,224 @@ int downloadImage(const String &imageUrl)
 
     if (httpCode != HTTP_CODE_OK)
     {
-        USBSerial.println("[HTTP] GET... failed, error: " + http.errorToString(httpCode) + " : " + String(httpCode));
-        USBSerial.println("Response: " + http.getString());
+        LOG_W("[HTTP] GET... failed, error: %s : %d", http.errorToString(httpCode).c_str(), httpCode);
         f.close();
         http.end();
         return -1;
     }
 
-    int fileCode = http.writeToStream(&f);
+    int bytesWritten = http.writeToStream(&f);
 
-    if (fileCode < 0)
+    if (bytesWritten < 0)
     {
-        USBSerial.println(F("Error writing to file"));
+        LOG_E("Error writing to file");
         f.close();
         http.end();
         return -1;
     }
 
-    USBSerial.println("File Downloaded");
+    LOG_D("File Downloaded");
 
     f.close();
     http.end();
-    return 0;
+    return bytesWritten;
 }
 
 int drawMCU(JPEGDRAW *pDraw)
 {
+    // Copy whole MCU rows into the decode target, clipped to its size
     uint16_t *pPixel = (uint16_t *)pDraw->pPixels;
-    for (int y = 0; y < pDraw->iHeight; y++)
+    int width = min(pDraw->iWidth, decodeTarget.width - pDraw->x);
+    if (width <= 0)
+        return 1;
+
+    for (int y = 0; y < pDraw->iHeight && y + pDraw->y < decodeTarget.height; y++)
     {
-        for (int x = 0; x < pDraw->iWidth; x++)
-        {
-            dma_display->drawPixel(x + pDraw->x, y + pDraw->y, pPixel[y * pDraw->iWidth + x]);
-        }
+        memcpy(&decodeTarget.pixels[(y + pDraw->y) * decodeTarget.width + pDraw->x], &pPixel[y * pDraw->iWidth], width * sizeof(uint16_t));
     }
     return 1; // Continue decoding
 }
 
-void drawJPEG(const char *filename, int xpos, int ypos)
+// Decodes a cover of any size into coverStaging. Large images use
+// JPEGDEC's 1/2, 1/4 or 1/8 scaled decode to get close to the panel size,
+// and the area-averaging resampler does the rest.
+bool drawJPEG(const char *filename)
 {
     File file = LittleFS.open(filename, "r");
     if (!file)
     {
-        USBSerial.println("Failed to open file for reading");
-        return;
+        LOG_E("Failed to open file for reading");
+        return false;
     }
 
     int fileSize = file.size();
     uint8_t *buffer = (uint8_t *)malloc(fileSize);
     if (!buffer)
     {
-        USBSerial.println("Not enough memory to load image");
+        LOG_E("Not enough memory to load image");
         file.close();
-        return;
+        return false;
     }
 
     file.read(buffer, fileSize);
     file.close();
 
+    bool decoded = false;
     if (jpeg.openRAM(buffer, fileSize, drawMCU))
     {
-        jpeg.decode(xpos, ypos, 0); // 0 = full size
+        int imageWidth = jpeg.getWidth();
+        int imageHeight = jpeg.getHeight();
+        int scale = jpegScaleFor(min(imageWidth, imageHeight), PANEL_RES_X);
+        int scaledWidth = (imageWidth + scale - 1) / scale;
+        int scaledHeight = (imageHeight + scale - 1) / scale;
+
+        uint16_t *scaled = nullptr;
+        if (scaledWidth <= PANEL_RES_X && scaledHeight <= PANEL_RES_Y)
+        {
+            // Already panel sized (or smaller), decode straight into the staging buffer
+            memset(coverStaging, 0, PANEL_RES_X * PANEL_RES_Y * sizeof(uint16_t));
+            decodeTarget = {coverStaging, PANEL_RES_X, PANEL_RES_Y};
+        }
+        else
+        {
+            scaled = (uint16_t *)calloc(scaledWidth * scaledHeight, sizeof(uint16_t));
+            decodeTarget = {scaled, scaledWidth, scaledHeight};
+        }
+
+        if (decodeTarget.pixels == nullptr)
+        {
+            LOG_E("Not enough memory to decode image");
+        }
+        else
+        {
+            int options = 0; // 0 = full size
+            if (scale == 8)
+                options = JPEG_SCALE_EIGHTH;
+            else if (scale == 4)
+                options = JPEG_SCALE_QUARTER;
+            else if (scale == 2)
+                options = JPEG_SCALE_HALF;
+            decoded = jpeg.decode(0, 0, options);
+        }
         jpeg.close();
+
+        if (scaled)
+        {
+            if (decoded)
+            {
+                resampleArea565(scaled, scaledWidth, scaledHeight, coverStaging, PANEL_RES_X, PANEL_RES_Y);
+            }
+            free(scaled);
+        }
     }
 
     free(buffer);
+    return decoded;
+}
+
+// Fetches the image size picked by artSelector and decodes it into
+// coverStaging. If that size fails it is marked over budget and the smallest image
+// is tried, so a size that cannot be fetched or decoded never blocks covers.
+bool downloadCover(JsonArrayConst images)
+{
+    int lastIndex = images.size() - 1;
+    int imageIndex = artSelector.choose(images.size());
+
+    for (;;)
+    {
+        unsigned long downloadStart = millis();
+        int downloadResult = downloadImage(images[imageIndex]["url"].as<String>());
+        unsigned long downloadMs = millis() - downloadStart;
+        LOG_D("Download result: %d", downloadResult);
+
+        bool decoded = false;
+        unsigned long decodeMs = 0;
+        if (downloadResult >= 0)
+        {
+            unsigned long decodeStart = millis();
+            decoded = drawJPEG("/cover.jpg");
+            decodeMs = millis() - decodeStart;
+        }
+
+        if (decoded)
+        {
+            artSelector.record(imageIndex, downloadMs, decodeMs, downloadResult);
+            const ArtSelector::Cost &cost = artSelector.cost(imageIndex);
+            LOG_I("Cover image %d: %d bytes, download %lu ms, decode %lu ms (avg %u + %u ms)",
+                  imageIndex, downloadResult, downloadMs, decodeMs, cost.downloadMs, cost.decodeMs);
+            return true;
+        }
+
+        artSelector.recordFailure(imageIndex);
+        LOG_W("Cover image %d failed after %lu ms", imageIndex, downloadMs + decodeMs);
+        if (imageIndex >= lastIndex)
+            return false;
+        imageIndex = lastIndex;
+    }
+}
+
+// Redisplays a cover decoded before (across pauses and reboots) without
+// touching the network or the JPEG decoder
+bool loadCoverCache(uint32_t key)
+{
+    File file = LittleFS.open(COVER_CACHE_FILE, "r");
+    if (!file)
+        return false;
+
+    CoverCacheHeader header;
+    bool ok = file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+              header.magic == COVER_CACHE_MAGIC && header.key == key &&
+              header.width == PANEL_RES_X && header.height == PANEL_RES_Y &&
+              header.size <= RLE565_MAX_SIZE(PANEL_RES_X * PANEL_RES_Y);
+
+    uint8_t *data = ok ? (uint8_t *)malloc(header.size) : nullptr;
+    ok = data != nullptr && file.read(data, header.size) == header.size &&
+         rle565Decode(data, header.size, coverStaging, PANEL_RES_X * PANEL_RES_Y);
+
+    free(data);
+    file.close();
+    return ok;
+}
+
+void saveCoverCache(uint32_t key)
+{
+    const size_t pixels = PANEL_RES_X * PANEL_RES_Y;
+    uint8_t *data = (uint8_t *)malloc(RLE565_MAX_SIZE(pixels));
+    if (!data)
+    {
+        LOG_W("Not enough memory to cache cover");
+        return;
+    }
+
+    CoverCacheHeader header = {COVER_CACHE_MAGIC, key, PANEL_RES_X, PANEL_RES_Y, 0};
+    header.size = rle565Encode(coverStaging, pixels, data);
+
+    File file = LittleFS.open(COVER_CACHE_FILE, "w");
+    if (file)
+    {
+        file.write((const uint8_t *)&header, sizeof(header));
+        file.write(data, header.size);
+        file.close();
+        LOG_D("Cover cached: %u bytes", header.size);
+    }
+    else
+    {
+        LOG_E("Error opening cover cache");
+    }
+    free(data);
 }
 
 void setup()
 {
     // Initialize USBSerial port for debugin
     USBSerial.begin(115200);
-    USBSerial.println("\nSTART!");
+    logBegin();
+    governor.begin();
+    LOG_I("START!");
     addSetupLog("Booting...");
 
     // Initialize led matrix
-    USBSerial.println(F("Led Matrix begin"));
+    LOG_I("Led Matrix begin");
     HUB75_I2S_CFG mxconfig(
         64,
         64,
@@ -378,23 +631,65 @@ void setup()
     dma_display->setBrightness8(30);
     dma_display->clearScreen();
     dma_display->flipDMABuffer();
+
+    coverLayer = new GFXcanvas16(PANEL_RES_X, PANEL_RES_Y);
+    clockLayer = new GFXcanvas16(PANEL_RES_X, PANEL_RES_Y);
+    coverStaging = (uint16_t *)calloc(PANEL_RES_X * PANEL_RES_Y, sizeof(uint16_t));
+    displayReady = compositor.begin(mxconfig.double_buff) && coverLayer->getBuffer() && clockLayer->getBuffer() && coverStaging;
+#ifdef ENABLE_CALENDAR
+    calendarLayer = new GFXcanvas16(PANEL_RES_X, PANEL_RES_Y);
+    displayReady = displayReady && calendarLayer->getBuffer();
+#endif
+#ifdef ENABLE_MARQUEE
+    overlayLayer = new GFXcanvas16(PANEL_RES_X, PANEL_RES_Y);
+    displayReady = displayReady && overlayLayer->getBuffer();
+#endif
+    if (!displayReady)
+    {
+        // Nothing can be drawn without the layers; loop() leaves this on screen
+        LOG_E("Not enough memory for display layers");
+        addSetupLog("Layers: failed");
+        return;
+    }
+
+    compositor.attach(LAYER_COVER, coverLayer);
+    compositor.attach(LAYER_CLOCK, clockLayer);
+#ifdef ENABLE_CALENDAR
+    compositor.attach(LAYER_CALENDAR, calendarLayer, true);
+#endif
+#ifdef ENABLE_MARQUEE
+    overlayLayer->fillScreen(0);
+    compositor.attach(LAYER_OVERLAY, overlayLayer, true);
+    compositor.setAlpha(LAYER_OVERLAY, 24); // let a little of the cover show through the backdrop
+    coverScene |= LAYER_BIT(LAYER_OVERLAY);
+#endif
     addSetupLog("Display ready");
 
+    // Core 0, next to the Wi-Fi stack; loop() keeps core 1 for drawing. Same
+    // stack size as the Arduino loop task, which ran the polls before.
+    loopTaskHandle = xTaskGetCurrentTaskHandle();
+    if (xTaskCreatePinnedToCore(pollTask, "poll", 8192, nullptr, 1, &pollTaskHandle, 0) != pdPASS)
+    {
+        LOG_E("Poll task: failed");
+        addSetupLog("Poll task: failed");
+        displayReady = false;
+        return;
+    }
+
     // Initialize LittleFS
-    USBSerial.print(F("LittleFS begin: "));
     if (!LittleFS.begin(true))
     {
-        USBSerial.println(F("failed"));
+        LOG_E("LittleFS begin: failed");
         addSetupLog("FS: failed");
     }
     else
     {
-        USBSerial.println(F("ok"));
+        LOG_I("LittleFS begin: ok");
         addSetupLog("FS: ok");
     }
 
     // Initialize Wifi
-    USBSerial.print(F("WiFi begin: "));
+    LOG_I("WiFi begin");
     addSetupLog("WiFi: connecting...");
 
     WiFi.mode(WIFI_STA);
@@ -402,38 +697,37 @@ void setup()
     while (WiFi.status() != WL_CONNECTED)
     {
         delay(500);
-        USBSerial.print(".");
     }
 
     if (WiFi.status() != WL_CONNECTED)
     {
-        USBSerial.println(F("\nWiFi failed! Restarting..."));
+        LOG_E("WiFi failed! Restarting...");
         addSetupLog("WiFi: failed");
         // ESP.restart();
     }
     else
     {
-        USBSerial.println((String) "RSSI : " + WiFi.RSSI() + " dB");
-        USBSerial.println("\nIP:" + WiFi.localIP().toString());
+        LOG_I("RSSI : %d dB", WiFi.RSSI());
+        LOG_I("IP: %s", WiFi.localIP().toString().c_str());
         addSetupLog("WiFi: connected");
         addSetupLog("IP: " + WiFi.localIP().toString());
     }
 
     WiFi.setAutoReconnect(true);
     WiFi.persistent(true);
+    setWifiPowerSave();
 
     // Initialize mDNS
-    USBSerial.print(F("mDNS begin: "));
     if (!MDNS.begin(PROJECTNAME))
     {
-        USBSerial.println(F("failed"));
+        LOG_W("mDNS begin: failed");
         addSetupLog("mDNS: failed");
         // ESP.restart();
     }
     else
     {
         // Set the hostname to "$PROJECTNAME.local"
-        USBSerial.println(F("ok"));
+        LOG_I("mDNS begin: ok");
         addSetupLog("mDNS: ok");
     }
 
@@ -443,11 +737,12 @@ void setup()
 
     if (!getLocalTime(&timeinfo))
     {
-        USBSerial.println(F("Failed to obtain time"));
+        LOG_W("Failed to obtain time");
         addSetupLog("Time: failed");
         return;
     }
-    USBSerial.println(&timeinfo, "%A, %B %d %Y %H:%M:%S");
+    LOG_I("Time: %04d-%02d-%02d %02d:%02d:%02d", timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
+          timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
     addSetupLog("Time: synced");
 
     ensureSpotifyReady(); // Will defer if no internet
@@ -456,38 +751,110 @@ void setup()
 
 void loop()
 {
-    dma_display->clearScreen();
-    ensureSpotifyReady();
+    if (!displayReady)
+    {
+        governor.idleFor(1000);
+        return;
+    }
 
-    if (!spotifyAuthenticated)
+    // Every wake is for a deadline (poll, frame or marquee step) or a
+    // finished poll, so all of the loop runs at full clock and only the
+    // sleep at the end is slowed down
+    governor.active();
+
+    if (pollDone)
     {
-        USBSerial.println(F("Spotify not ready, showing clock only"));
+        pollDone = false;
+        updateScreen();
+        pollBusy = false;
+    }
 
-        if (!getLocalTime(&timeinfo))
-        {
-            USBSerial.println(F("Failed to obtain time"));
-        }
+    unsigned long now = millis();
+    if (!pollBusy && (firstPoll || now - lastPoll >= POLL_INTERVAL_MS))
+    {
+        firstPoll = false;
+        lastPoll = now;
+        pollBusy = true;
+        xTaskNotifyGive(pollTaskHandle);
+    }
 
-        char datestring[6];
-        snprintf_P(datestring,
-                   countof(datestring),
-                   PSTR("%02u:%02u"),
-                   timeinfo.tm_hour,
-                   timeinfo.tm_min);
+#ifdef ENABLE_MARQUEE
+    // Scrolling only touches the marquee rows, the rest of the frame is reused
+    if (compositor.isShowing(coverScene) && marquee.tick(*overlayLayer, MARQUEE_Y, millis()))
+    {
+        compositor.invalidateRows(MARQUEE_Y, MARQUEE_Y + Marquee::height);
+    }
+#endif
 
-        uint16_t bodyColor = getClockDigitColor(timeinfo.tm_hour, timeinfo.tm_min);
-        drawClock(datestring, bodyColor, 39);
+    // Only transitions and content changes push pixels; a static screen costs nothing
+    unsigned long frameTime = millis();
+    if (compositor.render(*dma_display, frameTime))
+    {
+        lastFrame = frameTime;
         dma_display->flipDMABuffer();
-        delay(4000);
+    }
+
+    if (millis() - lastPowerReport >= CONFIG_POWER_REPORT_MS)
+    {
+        const PowerGovernor::Metrics &power = governor.stats();
+        LOG_I("Power: duty %u.%u%%, %u wakes, wake latency avg %u us max %u us, %u late",
+              power.dutyPermille() / 10, power.dutyPermille() % 10, power.wakes,
+              power.wakeLatencyAvgUs(), power.wakeLatencyMaxUs, power.missedDeadlines);
+        const SpotifyClient::Counters &stats = spotifyClient.stats();
+        LOG_I("Spotify requests: %u (%u this hour), 429: %u, failures: %u, wasted calls avoided: %u",
+              stats.requests, spotifyClient.requestsInWindow(), stats.rateLimited, stats.failures, stats.wastedCallsAvoided());
+        governor.resetStats();
+        lastPowerReport = millis();
+    }
+
+    // Sleep until the next thing that has to happen: a transition frame, a
+    // marquee step, the next poll or the running poll finishing. The poll
+    // task's TLS and decoding need the full clock, which both cores share.
+    now = millis();
+    unsigned long stepWait = POLL_INTERVAL_MS;
+#ifdef ENABLE_MARQUEE
+    if (compositor.isShowing(coverScene))
+    {
+        stepWait = marquee.msUntilStep(now, POLL_INTERVAL_MS);
+    }
+#endif
+    governor.idleFor(msUntilNextDeadline(now, lastPoll, POLL_INTERVAL_MS, pollBusy, compositor.isAnimating(), lastFrame,
+                                         FRAME_INTERVAL_MS, stepWait),
+                     pollBusy);
+}
+
+void pollTask(void *)
+{
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        pollSpotify();
+        pollDone = true;
+        xTaskNotifyGive(loopTaskHandle); // cut the loop's sleep short
+    }
+}
+
+// Poll task: everything that waits on the network or decodes. Fills
+// pollOutcome and coverStaging, never the layers.
+void pollSpotify()
+{
+    PollOutcome &out = pollOutcome;
+    out.trackChanged = false;
+    out.coverChanged = false;
+
+    ensureSpotifyReady();
+    out.authenticated = spotifyAuthenticated;
+    if (!spotifyAuthenticated)
+    {
+        LOG_D("Spotify not ready, showing clock only");
+        out.playing = false;
         return;
     }
 
-    USBSerial.println(F("Checking Spotify state"));
+    LOG_D("Checking Spotify state");
 
-    response currentState = sp.currently_playing();
-    USBSerial.println();
-    USBSerial.println(currentState.reply.as<String>());
-    USBSerial.println();
+    response currentState;
+    SpotifyClient::Result pollResult = spotifyClient.currentlyPlaying(currentState, millis());
 
     /*
     State
@@ -496,142 +863,198 @@ void loop()
       401 Bad or expired token. This can happen if the user revoked a token or the access token has expired. You should re-authenticate the user.
       403 Bad OAuth request (wrong consumer key, bad nonce, expired timestamp...). Unfortunately, re-authenticating the user won't help here.
       429 The app has exceeded its rate limits.
+
+    Retries, token refresh and backoff are handled by SpotifyClient; this
+    only decides what to fetch, and updateScreen() what to draw.
     */
 
-    if (currentState.status_code != 200)
+    if (pollResult == SpotifyClient::Result::Skipped)
     {
-        USBSerial.println("Error, code: " + String(currentState.status_code));
-
-        if (currentState.status_code == 201)
-        {
-            USBSerial.println(F("Spotify on inactive"));
-
-            isSpotifyPlaying = false;
-        }
-
-        if (currentState.status_code == 204)
-        {
-            USBSerial.println(F("No Content - Spotify not playing"));
-
-            isSpotifyPlaying = false;
-        }
-
-        if (currentState.status_code == 401)
-        {
-            USBSerial.println(F("The access token expired"));
+        LOG_D("Spotify poll skipped (backoff, breaker or budget)");
+    }
 
-            sp.get_access_token();
-            currentState = sp.currently_playing();
-        }
+    if (pollResult == SpotifyClient::Result::Failed)
+    {
+        LOG_W("Spotify error, code: %d", currentState.status_code);
+    }
 
-        if (currentState.status_code == 403)
-        {
-            USBSerial.println(F("Bad OAuth request"));
-        }
+    if (pollResult == SpotifyClient::Result::Ok && currentState.status_code == 204)
+    {
+        LOG_D("No Content - Spotify not playing");
 
-        if (currentState.status_code == 429)
-        {
-            USBSerial.println(F("The app has exceeded its rate limits."));
-        }
+        isSpotifyPlaying = false;
+    }
 
-        if (currentState.reply["message"].as<String>().equals("Timeout receiving headers"))
-        {
-            USBSerial.println(F("Timeout receiving headers"));
-            currentState = sp.currently_playing();
-        }
+    // Degrade to the clock while the breaker is open instead of showing stale art
+    if (spotifyClient.breakerState() == SpotifyClient::Breaker::Open)
+    {
+        isSpotifyPlaying = false;
     }
 
     // check if is play is null
-    if (!currentState.reply["is_playing"].isNull())
+    if (pollResult == SpotifyClient::Result::Ok && !currentState.reply["is_playing"].isNull())
     {
         isSpotifyPlaying = currentState.reply["is_playing"].as<bool>();
     }
 
+    out.playing = isSpotifyPlaying;
     if (isSpotifyPlaying)
     {
-        USBSerial.println(F("Spotify is playing"));
-        currentAlbumArtUrl = currentState.reply["item"]["album"]["images"][2]["url"].as<String>();
+        LOG_D("Spotify is playing");
+
+#ifdef ENABLE_MARQUEE
+        // Title and artists, once per track
+        if (!currentState.reply["item"]["name"].isNull())
+        {
+            String trackId = currentState.reply["item"]["id"].as<String>();
+            if (!trackId.equals(currentTrackId))
+            {
+                currentTrackId = trackId;
+
+                String line = currentState.reply["item"]["name"].as<String>();
+                JsonArrayConst artists = currentState.reply["item"]["artists"].as<JsonArrayConst>();
+                for (size_t i = 0; i < artists.size(); ++i)
+                {
+                    line += i == 0 ? " - " : ", ";
+                    line += artists[i]["name"].as<String>();
+                }
+                out.trackLine = line;
+                out.trackChanged = true;
+            }
+        }
+#endif
+        JsonArrayConst images = currentState.reply["item"]["album"]["images"].as<JsonArrayConst>();
 
-        if (!currentState.reply["item"]["album"]["images"][2]["url"].isNull())
+        if (images.size() > 0)
         {
+            // Images are sorted largest first; the smallest URL identifies the
+            // cover no matter which size ends up downloaded
+            currentAlbumArtUrl = images[images.size() - 1]["url"].as<String>();
 
             if (!currentAlbumArtUrl.equals(previousAlbumArtUrl))
             {
                 previousAlbumArtUrl = currentAlbumArtUrl;
-                int downloadResult = downloadImage(currentAlbumArtUrl);
 
-                USBSerial.println("Download result: " + String(downloadResult));
+                // The cover layer keeps its pixels, so only a new cover is loaded
+                uint32_t coverKey = coverCacheKey(currentAlbumArtUrl.c_str());
+                unsigned long loadStart = millis();
+
+                if (loadCoverCache(coverKey))
+                {
+                    LOG_I("Cover from flash cache in %lu ms", millis() - loadStart);
+                    out.coverChanged = true;
+                }
+                else if (downloadCover(images))
+                {
+                    saveCoverCache(coverKey);
+                    out.coverChanged = true;
+                }
             }
         }
-
-        drawJPEG("/cover.jpg", 0, 0);
+        return;
     }
-    else
+
+    LOG_D("Spotify is not playing, showing clock");
+    currentAlbumArtUrl = "";
+    previousAlbumArtUrl = " ";
+
+#ifdef ENABLE_CALENDAR
+    unsigned long now = millis();
+    if (now - lastCalendarFetch >= 10000 || lastCalendarFetch == 0)
     {
-        USBSerial.println(F("Spotify is not playing, drawing clock"));
+        lastCalendarResponse = fetchCalendar();
+        lastCalendarFetch = now;
+    }
+    out.calendar = lastCalendarResponse;
+#endif
+}
+
+// Loop task: turns the last poll's outcome into layers
+void updateScreen()
+{
+    const PollOutcome &poll = pollOutcome;
 
-        if (!getLocalTime(&timeinfo))
+    if (poll.playing)
+    {
+#ifdef ENABLE_MARQUEE
+        // Rasterized once per track
+        if (poll.trackChanged && !marquee.setText(poll.trackLine.c_str()))
         {
-            USBSerial.println(F("Failed to obtain time"));
+            LOG_E("Not enough memory for marquee");
         }
+#endif
+        if (poll.coverChanged)
+        {
+            bool wasShowingCover = compositor.isShowing(coverScene);
+            memcpy(coverLayer->getBuffer(), coverStaging, PANEL_RES_X * PANEL_RES_Y * sizeof(uint16_t));
+            compositor.invalidate();
+            if (wasShowingCover)
+            {
+                compositor.refresh(Compositor::Transition::Slide, millis());
+            }
+        }
+
+        compositor.show(coverScene, Compositor::Transition::Crossfade, millis());
+        return;
+    }
 
-        char datestring[6];
-        snprintf_P(datestring,
-                   countof(datestring),
-                   PSTR("%02u:%02u"),
-                   timeinfo.tm_hour,
-                   timeinfo.tm_min);
+    if (!getLocalTime(&timeinfo, 0))
+    {
+        LOG_W("Failed to obtain time");
+    }
 
-        uint16_t bodyColor = getClockDigitColor(timeinfo.tm_hour, timeinfo.tm_min);
-        bool hasCalendar = false;
+    char datestring[6];
+    snprintf_P(datestring,
+               countof(datestring),
+               PSTR("%02u:%02u"),
+               timeinfo.tm_hour,
+               timeinfo.tm_min);
 
-#ifdef ENABLE_CALENDAR
-        unsigned long now = millis();
-        if (now - lastCalendarFetch >= 10000 || lastCalendarFetch == 0)
-        {
-            lastCalendarResponse = fetchCalendar();
-            lastCalendarFetch = now;
-        }
+    uint16_t bodyColor = getClockDigitColor(timeinfo.tm_hour, timeinfo.tm_min);
+    clockLayer->fillScreen(0);
 
-        hasCalendar = lastCalendarResponse.length() > 0;
-#endif
+    if (!poll.authenticated)
+    {
+        drawClock(datestring, bodyColor, 39);
+        compositor.show(LAYER_BIT(LAYER_CLOCK), Compositor::Transition::Crossfade, millis());
+        return;
+    }
 
 #ifdef ENABLE_CALENDAR
-        if (hasCalendar)
-        {
-            const int panelHeight = PANEL_RES_Y;
-            int clockHeight = measureTextHeight(datestring, &FreeSans12pt7b);
-            int calendarLineHeight = measureTextHeight("A", &Picopixel) + 2; // add 2px spacing between lines
-            int calendarLines = countLines(lastCalendarResponse);
+    const String &calendar = poll.calendar;
+    bool hasCalendar = calendar.length() > 0;
+    calendarLayer->fillScreen(0);
 
-            int contentHeight = clockHeight + calendarLineHeight * calendarLines;
-            int availableHeight = panelHeight; // panel height
+    if (hasCalendar)
+    {
+        const int panelHeight = PANEL_RES_Y;
+        int clockHeight = measureTextHeight(datestring, &FreeSans12pt7b);
+        int calendarLineHeight = measureTextHeight("A", &Picopixel) + 2; // add 2px spacing between lines
+        int calendarLines = countLines(calendar);
 
-            // space-around: equal space around each block; top/bottom get half the between space
-            int remaining = max(0, availableHeight - contentHeight);
-            // For two blocks, spacing_between = remaining / 2, top = bottom = spacing_between / 2
-            float spacingBetween = remaining / 2.0f;
-            float edgeSpacing = spacingBetween / 2.0f;
+        int contentHeight = clockHeight + calendarLineHeight * calendarLines;
+        int availableHeight = panelHeight; // panel height
 
-            int clockY = static_cast<int>(edgeSpacing + clockHeight + 0.5f);
-            int calendarStartY = static_cast<int>(clockY + spacingBetween + calendarLineHeight + 0.5f);
+        // space-around: equal space around each block; top/bottom get half the between space
+        int remaining = max(0, availableHeight - contentHeight);
+        // For two blocks, spacing_between = remaining / 2, top = bottom = spacing_between / 2
+        float spacingBetween = remaining / 2.0f;
+        float edgeSpacing = spacingBetween / 2.0f;
 
-            drawClock(datestring, bodyColor, clockY);
-            drawCalendarLines(lastCalendarResponse, bodyColor, calendarStartY, calendarLineHeight);
-        }
-        else
-        {
-            drawClock(datestring, bodyColor, 39);
-        }
-#else
-        // Calendar feature disabled: just draw the clock centered at default Y
-        drawClock(datestring, bodyColor, 39);
-#endif
+        int clockY = static_cast<int>(edgeSpacing + clockHeight + 0.5f);
+        int calendarStartY = static_cast<int>(clockY + spacingBetween + calendarLineHeight + 0.5f);
 
-        currentAlbumArtUrl = "";
-        previousAlbumArtUrl = " ";
+        drawClock(datestring, bodyColor, clockY);
+        drawCalendarLines(calendar, bodyColor, calendarStartY, calendarLineHeight);
     }
-    dma_display->flipDMABuffer();
+    else
+    {
+        drawClock(datestring, bodyColor, 39);
+    }
+#else
+    // Calendar feature disabled: just draw the clock centered at default Y
+    drawClock(datestring, bodyColor, 39);
+#endif
 
-    delay(4000);
-}
\ No newline at end of file
+    compositor.show(LAYER_BIT(LAYER_CLOCK) | LAYER_BIT(LAYER_CALENDAR), Compositor::Transition::Crossfade, millis());
+}
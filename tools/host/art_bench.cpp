@@ -0,0 +1,56 @@
+// End-to-end cost of each Spotify image size for the cover layer, following
+// drawJPEG: JPEGDEC-style 1/2..1/8 scaled decode (libjpeg here), then
+// resampleArea565 down to the panel. Download time is modelled from the
+// file size as connect time plus size over throughput; pass the values the
+// device logs ("Cover image N: ... download X ms") to match a real network.
+//
+//   build/art_bench [--kbps=N] [--connect-ms=N] [cover640.jpg cover300.jpg cover64.jpg]
+//
+// Decode times are host times, so they only rank the options. Quality is
+// PSNR against the original averaged straight down to 64x64; the generated
+// sample JPEGs all use one quality setting, so only real Spotify files show
+// the heavier compression of the CDN's 64px thumbnail.
+
+#include "jpeg_host.h"
+
+int main(int argc, char **argv)
+{
+    double kbps = 4000;
+    double connectMs = 250;
+    std::vector<char *> args = {argv[0]};
+    for (int i = 1; i < argc; ++i)
+    {
+        if (sscanf(argv[i], "--kbps=%lf", &kbps) == 1 || sscanf(argv[i], "--connect-ms=%lf", &connectMs) == 1)
+            continue;
+        args.push_back(argv[i]);
+    }
+
+    SampleCover cover;
+    if (!loadSampleCover(args.size(), args.data(), cover))
+        return 1;
+    Rgb888Image reference = squareResize(cover.original, PANEL_RES_X);
+
+    printf("download model: %.0f ms connect + size at %.0f kbit/s; budget %d ms\n", connectMs, kbps, CONFIG_ART_LATENCY_BUDGET_MS);
+    printf("%-5s %7s %5s %10s %11s %9s %9s\n", "index", "bytes", "scale", "decode ms", "download ms", "total ms", "PSNR dB");
+
+    static uint16_t panel[PANEL_RES_X * PANEL_RES_Y];
+    for (int index = 0; index < ART_IMAGE_COUNT; ++index)
+    {
+        const std::vector<uint8_t> &jpeg = cover.jpegs[index];
+        int scale = 1;
+        bool ok = true;
+        double decodeUs = medianMicros(50, [&]
+                                       { ok = ok && decodeToPanel(jpeg, panel, scale); });
+        if (!ok)
+        {
+            printf("%-5d decode failed\n", index);
+            return 1;
+        }
+
+        double downloadMs = connectMs + jpeg.size() * 8.0 / kbps;
+        printf("%-5d %7zu %5s %10.2f %11.0f %9.0f %9.2f\n", index, jpeg.size(),
+               scale == 1 ? "1" : scale == 2 ? "1/2" : scale == 4 ? "1/4" : "1/8",
+               decodeUs / 1000, downloadMs, downloadMs + decodeUs / 1000, psnr565(panel, reference));
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+// Throughput of the compositor's RGB565 blend kernels and of whole
+// transition frames. These are host numbers: the ESP32-S3 runs the same
+// code many times slower, so use them to compare kernels and changes, not
+// as device frame times.
+
+#include <compositor.h>
+#include <chrono>
+#include <stdio.h>
+
+#define FRAME_PIXELS (PANEL_RES_X * PANEL_RES_Y)
+
+static uint32_t rng = 0x12345678;
+
+static uint16_t random565()
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return (uint16_t)rng;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Per channel blend the packed kernel has to match
+static int channelError(uint16_t bg, uint16_t fg, uint8_t alpha, uint16_t got)
+{
+    static const int shifts[3] = {11, 5, 0};
+    static const int masks[3] = {0x1F, 0x3F, 0x1F};
+    int worst = 0;
+    for (int ch = 0; ch < 3; ++ch)
+    {
+        int b = (bg >> shifts[ch]) & masks[ch];
+        int f = (fg >> shifts[ch]) & masks[ch];
+        int expected = b + (((f - b) * alpha) >> 5);
+        int actual = (got >> shifts[ch]) & masks[ch];
+        int error = expected > actual ? expected - actual : actual - expected;
+        if (error > worst)
+            worst = error;
+    }
+    return worst;
+}
+
+class NullDisplay : public Adafruit_GFX
+{
+public:
+    uint32_t checksum = 0;
+    void drawRGBBitmap(int16_t, int16_t y, uint16_t *bitmap, int16_t w, int16_t h) override
+    {
+        checksum += bitmap[(w * h) / 2] + y;
+    }
+};
+
+static void benchRow(const char *name, bool keyed, const uint16_t *bg, const uint16_t *fg, uint16_t *out)
+{
+    const int frames = 20000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; ++i)
+    {
+        uint8_t alpha = i % (ALPHA_OPAQUE + 1);
+        if (keyed)
+            blendRowKeyed565(out, bg, fg, FRAME_PIXELS, alpha, 0x0000);
+        else
+            blendRow565(out, bg, fg, FRAME_PIXELS, alpha);
+    }
+    double seconds = secondsSince(start);
+    double pixels = (double)frames * FRAME_PIXELS;
+    printf("%-22s %8.1f Mpx/s  %7.2f us/frame  (checksum %u)\n", name,
+           pixels / seconds / 1e6, seconds / frames * 1e6, out[FRAME_PIXELS / 3]);
+}
+
+static void benchTransition(const char *name, Compositor::Transition transition, GFXcanvas16 &cover, GFXcanvas16 &clock)
+{
+    Compositor compositor;
+    if (!compositor.begin())
+    {
+        printf("%-22s out of memory\n", name);
+        return;
+    }
+    compositor.attach(LAYER_COVER, &cover);
+    compositor.attach(LAYER_CLOCK, &clock, true);
+
+    NullDisplay display;
+    compositor.show(LAYER_BIT(LAYER_COVER), Compositor::Transition::Cut, 0);
+    compositor.render(display, 0);
+    compositor.show(LAYER_BIT(LAYER_COVER) | LAYER_BIT(LAYER_CLOCK), transition, 0);
+
+    // Every render inside the transition window composes a full frame
+    const int frames = 20000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; ++i)
+        compositor.render(display, 1 + i % (CONFIG_TRANSITION_MS - 1));
+    double seconds = secondsSince(start);
+
+    printf("%-22s %8.1f Mpx/s  %7.2f us/frame  (checksum %u)\n", name,
+           (double)frames * FRAME_PIXELS / seconds / 1e6, seconds / frames * 1e6, display.checksum);
+}
+
+int main()
+{
+    static uint16_t bg[FRAME_PIXELS], fg[FRAME_PIXELS], out[FRAME_PIXELS];
+    for (int i = 0; i < FRAME_PIXELS; ++i)
+    {
+        bg[i] = random565();
+        fg[i] = i % 5 == 0 ? 0x0000 : random565(); // some transparent pixels for the keyed kernel
+    }
+
+    // Exhaustive over alpha, sampled over colour pairs
+    int worst = 0;
+    for (int i = 0; i < 2000000; ++i)
+    {
+        uint16_t b = random565(), f = random565();
+        uint8_t alpha = i % (ALPHA_OPAQUE + 1);
+        int error = channelError(b, f, alpha, blend565(b, f, alpha));
+        if (error > worst)
+            worst = error;
+    }
+    printf("blend565 max channel error vs reference: %d\n", worst);
+
+    benchRow("blendRow565", false, bg, fg, out);
+    benchRow("blendRowKeyed565", true, bg, fg, out);
+
+    GFXcanvas16 cover(PANEL_RES_X, PANEL_RES_Y), clock(PANEL_RES_X, PANEL_RES_Y);
+    memcpy(cover.getBuffer(), bg, sizeof(bg));
+    memcpy(clock.getBuffer(), fg, sizeof(fg));
+    benchTransition("crossfade frame", Compositor::Transition::Crossfade, cover, clock);
+    benchTransition("slide frame", Compositor::Transition::Slide, cover, clock);
+
+    return worst == 0 ? 0 : 1;
+}
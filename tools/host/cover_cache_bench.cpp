@@ -0,0 +1,70 @@
+// Cover cache (/cover.rle) against the JPEGs it replaces on a redisplay:
+// bytes read from flash and time until the cover layer holds the finished
+// frame (the compositor pushes whole frames, so that is the first pixel).
+// The JPEG path includes the scaled decode and resample drawJPEG does.
+//
+//   build/cover_cache_bench [cover640.jpg cover300.jpg cover64.jpg]
+//
+// Without arguments a photo and a flat graphic cover are generated. Times
+// are host times and flash reads are not included; reading scales with the
+// byte counts.
+
+#include <cover_cache.h>
+#include "jpeg_host.h"
+
+#define PANEL_PIXELS (PANEL_RES_X * PANEL_RES_Y)
+
+static bool benchCover(const char *name, const SampleCover &cover)
+{
+    // The cache holds whatever the preferred size decoded to
+    static uint16_t panel[PANEL_PIXELS], restored[PANEL_PIXELS];
+    int scale;
+    if (!decodeToPanel(cover.jpegs[CONFIG_ART_PREFERRED_INDEX], panel, scale))
+    {
+        printf("%s: decode failed\n", name);
+        return false;
+    }
+
+    static uint8_t encoded[RLE565_MAX_SIZE(PANEL_PIXELS)];
+    size_t size = rle565Encode(panel, PANEL_PIXELS, encoded);
+    bool ok = true;
+    double rleUs = medianMicros(200, [&]
+                                { ok = ok && rle565Decode(encoded, size, restored, PANEL_PIXELS); });
+    if (!ok || memcmp(panel, restored, sizeof(panel)) != 0)
+    {
+        printf("%s: cache round trip failed\n", name);
+        return false;
+    }
+
+    printf("%s\n", name);
+    printf("  %-22s %7s %18s\n", "source", "bytes", "first pixel us");
+    printf("  %-22s %7zu %18.1f\n", "cover.rle", sizeof(CoverCacheHeader) + size, rleUs);
+    printf("  %-22s %7zu %18s\n", "raw RGB565", sizeof(panel), "(memcpy)");
+
+    static const char *labels[ART_IMAGE_COUNT] = {"JPEG image 0 (640px)", "JPEG image 1 (300px)", "JPEG image 2 (64px)"};
+    for (int index = 0; index < ART_IMAGE_COUNT; ++index)
+    {
+        double jpegUs = medianMicros(50, [&]
+                                     { decodeToPanel(cover.jpegs[index], restored, scale); });
+        printf("  %-22s %7zu %18.1f\n", labels[index], cover.jpegs[index].size(), jpegUs);
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    SampleCover photo;
+    if (!loadSampleCover(argc, argv, photo))
+        return 1;
+    if (!benchCover(argc == 4 ? "given cover" : "photo cover", photo))
+        return 1;
+
+    if (argc != 4)
+    {
+        SampleCover graphic;
+        makeGraphicCover(graphic);
+        if (!benchCover("graphic cover", graphic))
+            return 1;
+    }
+    return 0;
+}
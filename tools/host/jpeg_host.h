@@ -0,0 +1,267 @@
+// libjpeg(-turbo) helpers for the host benchmarks: test covers at Spotify's
+// image sizes, and a scaled RGB565 decode equivalent to JPEGDEC's
+#pragma once
+
+#include <cover_art.h>
+#include <jpeglib.h>
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#define SAMPLE_IMAGE "../../images/hd_wf2.jpg"
+
+struct Rgb888Image
+{
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels; // RGB, row major
+};
+
+static inline bool readFile(const char *path, std::vector<uint8_t> &data)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return false;
+    fseek(f, 0, SEEK_END);
+    data.resize(ftell(f));
+    fseek(f, 0, SEEK_SET);
+    bool ok = fread(data.data(), 1, data.size(), f) == data.size();
+    fclose(f);
+    return ok;
+}
+
+// Decodes at 1/scale (1, 2, 4 or 8) into RGB888 or RGB565 (out_color_space
+// JCS_RGB or JCS_RGB565); pixels receives width * height * components values
+template <typename T>
+static inline bool decodeJpeg(const std::vector<uint8_t> &jpeg, int scale, J_COLOR_SPACE space, std::vector<T> &pixels, int &width, int &height)
+{
+    jpeg_decompress_struct cinfo;
+    jpeg_error_mgr jerr;
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, jpeg.data(), jpeg.size());
+    if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK)
+    {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = scale;
+    cinfo.out_color_space = space;
+    cinfo.dither_mode = JDITHER_NONE;
+    jpeg_start_decompress(&cinfo);
+
+    width = cinfo.output_width;
+    height = cinfo.output_height;
+    int rowValues = width * (space == JCS_RGB565 ? 1 : cinfo.output_components);
+    pixels.resize((size_t)rowValues * height);
+    while (cinfo.output_scanline < cinfo.output_height)
+    {
+        JSAMPROW row = (JSAMPROW)&pixels[(size_t)cinfo.output_scanline * rowValues];
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return true;
+}
+
+static inline std::vector<uint8_t> encodeJpeg(const Rgb888Image &image, int quality)
+{
+    jpeg_compress_struct cinfo;
+    jpeg_error_mgr jerr;
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_compress(&cinfo);
+
+    unsigned char *buffer = nullptr;
+    unsigned long size = 0;
+    jpeg_mem_dest(&cinfo, &buffer, &size);
+
+    cinfo.image_width = image.width;
+    cinfo.image_height = image.height;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, quality, TRUE);
+    jpeg_start_compress(&cinfo, TRUE);
+    while (cinfo.next_scanline < cinfo.image_height)
+    {
+        JSAMPROW row = (JSAMPROW)&image.pixels[(size_t)cinfo.next_scanline * image.width * 3];
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+
+    std::vector<uint8_t> jpeg(buffer, buffer + size);
+    free(buffer);
+    return jpeg;
+}
+
+// Centre square of image scaled to size x size: box average when shrinking,
+// nearest neighbour when growing
+static inline Rgb888Image squareResize(const Rgb888Image &image, int size)
+{
+    int side = std::min(image.width, image.height);
+    int x0 = (image.width - side) / 2;
+    int y0 = (image.height - side) / 2;
+
+    Rgb888Image out;
+    out.width = out.height = size;
+    out.pixels.resize((size_t)size * size * 3);
+    for (int y = 0; y < size; ++y)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            int sx0 = x * side / size, sx1 = std::max(sx0 + 1, (x + 1) * side / size);
+            int sy0 = y * side / size, sy1 = std::max(sy0 + 1, (y + 1) * side / size);
+            for (int c = 0; c < 3; ++c)
+            {
+                uint32_t sum = 0;
+                for (int sy = sy0; sy < sy1; ++sy)
+                    for (int sx = sx0; sx < sx1; ++sx)
+                        sum += image.pixels[((size_t)(y0 + sy) * image.width + x0 + sx) * 3 + c];
+                out.pixels[((size_t)y * size + x) * 3 + c] = (sum + (sx1 - sx0) * (sy1 - sy0) / 2) / ((sx1 - sx0) * (sy1 - sy0));
+            }
+        }
+    }
+    return out;
+}
+
+// What drawJPEG does with JPEGDEC: the largest 1/2..1/8 reduction that stays
+// at or above the panel size, then resampleArea565 for the rest
+static inline bool decodeToPanel(const std::vector<uint8_t> &jpeg, uint16_t *panel, int &scale)
+{
+    static std::vector<uint16_t> scaled;
+    int width, height;
+
+    jpeg_decompress_struct cinfo;
+    jpeg_error_mgr jerr;
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, jpeg.data(), jpeg.size());
+    jpeg_read_header(&cinfo, TRUE);
+    scale = jpegScaleFor(std::min(cinfo.image_width, cinfo.image_height), PANEL_RES_X);
+    jpeg_destroy_decompress(&cinfo);
+
+    if (!decodeJpeg(jpeg, scale, JCS_RGB565, scaled, width, height))
+        return false;
+
+    if (width <= PANEL_RES_X && height <= PANEL_RES_Y)
+    {
+        memset(panel, 0, PANEL_RES_X * PANEL_RES_Y * sizeof(uint16_t));
+        for (int y = 0; y < height; ++y)
+            memcpy(&panel[y * PANEL_RES_X], &scaled[y * width], width * sizeof(uint16_t));
+    }
+    else
+    {
+        resampleArea565(scaled.data(), width, height, panel, PANEL_RES_X, PANEL_RES_Y);
+    }
+    return true;
+}
+
+// Original image and its JPEGs at Spotify's three sizes (index 0 = largest).
+// Paths on the command line are used as the three JPEGs; otherwise they are
+// made from the sample photo at the quality Spotify's CDN roughly uses.
+struct SampleCover
+{
+    Rgb888Image original;
+    std::vector<uint8_t> jpegs[3];
+};
+
+static inline void makeCoverJpegs(SampleCover &cover)
+{
+    static const int sizes[3] = {640, 300, 64};
+    for (int i = 0; i < 3; ++i)
+        cover.jpegs[i] = encodeJpeg(squareResize(cover.original, sizes[i]), 80);
+}
+
+static inline bool loadSampleCover(int argc, char **argv, SampleCover &cover)
+{
+    if (argc == 4)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            if (!readFile(argv[i + 1], cover.jpegs[i]))
+            {
+                printf("cannot read %s\n", argv[i + 1]);
+                return false;
+            }
+        }
+        return decodeJpeg(cover.jpegs[0], 1, JCS_RGB, cover.original.pixels, cover.original.width, cover.original.height);
+    }
+
+    std::vector<uint8_t> photo;
+    if (!readFile(SAMPLE_IMAGE, photo) || !decodeJpeg(photo, 1, JCS_RGB, cover.original.pixels, cover.original.width, cover.original.height))
+    {
+        printf("cannot read %s (run from tools/host, or pass the 640, 300 and 64px JPEGs of a cover)\n", SAMPLE_IMAGE);
+        return false;
+    }
+    makeCoverJpegs(cover);
+    return true;
+}
+
+// Flat colours, hard edges and a gradient, like a typical graphic design
+// cover; photos are the other extreme
+static inline void makeGraphicCover(SampleCover &cover)
+{
+    const int size = 640;
+    Rgb888Image &image = cover.original;
+    image.width = image.height = size;
+    image.pixels.resize((size_t)size * size * 3);
+    for (int y = 0; y < size; ++y)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            uint8_t rgb[3] = {(uint8_t)(20 + y / 8), 10, (uint8_t)(90 + y / 6)};
+            int dx = x - 400, dy = y - 240;
+            if (dx * dx + dy * dy < 150 * 150)
+            {
+                rgb[0] = 250, rgb[1] = 200, rgb[2] = 40;
+            }
+            else if (y > 470 && y < 560)
+            {
+                bool stripe = (x / 24) % 3 == 0;
+                rgb[0] = rgb[1] = rgb[2] = stripe ? 0 : 240;
+            }
+            memcpy(&image.pixels[((size_t)y * size + x) * 3], rgb, 3);
+        }
+    }
+    makeCoverJpegs(cover);
+}
+
+// PSNR in dB of a PANEL_RES_X x PANEL_RES_Y RGB565 image against reference
+static inline double psnr565(const uint16_t *image, const Rgb888Image &reference)
+{
+    double squared = 0;
+    for (int i = 0; i < reference.width * reference.height; ++i)
+    {
+        uint16_t c = image[i];
+        int rgb[3] = {((c >> 11) * 255 + 15) / 31, (((c >> 5) & 0x3F) * 255 + 31) / 63, ((c & 0x1F) * 255 + 15) / 31};
+        for (int ch = 0; ch < 3; ++ch)
+        {
+            double d = rgb[ch] - reference.pixels[(size_t)i * 3 + ch];
+            squared += d * d;
+        }
+    }
+    double mse = squared / (reference.width * reference.height * 3);
+    return mse == 0 ? 99.0 : 10 * log10(255.0 * 255.0 / mse);
+}
+
+// Median of runs timings of fn, in microseconds
+template <typename F>
+static inline double medianMicros(int runs, F fn)
+{
+    std::vector<double> times;
+    for (int i = 0; i < runs; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        times.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
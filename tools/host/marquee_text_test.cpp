@@ -0,0 +1,53 @@
+// toPanelText(): the ASCII the marquee font can draw for titles and artists
+// in other scripts, and for broken UTF-8.
+
+#include <marquee.h>
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK_TEXT(utf8, expected)                                                        \
+    do                                                                                    \
+    {                                                                                     \
+        String a = toPanelText(utf8);                                                     \
+        if (strcmp(a.c_str(), (expected)) != 0)                                           \
+        {                                                                                 \
+            printf("%s:%d: %s is \"%s\", expected \"%s\"\n", __FILE__, __LINE__, #utf8, \
+                   a.c_str(), (expected));                                                \
+            failures++;                                                                   \
+        }                                                                                 \
+    } while (0)
+
+int main()
+{
+    // Latin-1 accents fall back to the base letter
+    CHECK_TEXT("Beyonc\xC3\xA9", "Beyonce");
+    CHECK_TEXT("Sigur R\xC3\xB3s - \xC3\x81g\xC3\xA6tis byrjun", "Sigur Ros - Agatis byrjun");
+
+    // Greek, with tonos and final sigma
+    CHECK_TEXT("\xCE\x91\xCE\xB8\xCE\xAE\xCE\xBD\xCE\xB1", "Athina");
+    CHECK_TEXT("\xCE\x9A\xCE\xBD\xCF\x89\xCF\x83\xCF\x8C\xCF\x82", "Knosos");
+
+    // Cyrillic, including the Ukrainian letters outside U+0410..U+044F
+    CHECK_TEXT("\xD0\x9C\xD0\xBE\xD1\x81\xD0\xBA\xD0\xB2\xD0\xB0", "Moskva");
+    CHECK_TEXT("\xD0\xA3\xD0\xBA\xD1\x80\xD0\xB0\xD1\x97\xD0\xBD\xD0\xB0", "Ukrayina");
+    CHECK_TEXT("\xD0\x84\xD0\xB2\xD0\xB0 \xD2\x90\xD1\x96", "Yeva Gi");
+
+    // Scripts without a spelling collapse to one '?' per run
+    CHECK_TEXT("\xE6\x9D\xB1\xE4\xBA\xAC x", "? x");
+    CHECK_TEXT("\xF0\x9F\x8E\xB5\xF0\x9F\x8E\xB6 x", "? x");
+
+    // Invisible code points draw nothing
+    CHECK_TEXT("a\xE2\x80\x8B" "b\xEF\xBB\xBF", "ab");
+
+    // Truncated and invalid UTF-8
+    CHECK_TEXT("trunc\xC3", "trunc?");
+    CHECK_TEXT("trunc\xE2\x80", "trunc?");
+    CHECK_TEXT("a\x80\x80" "b", "a?b");
+    CHECK_TEXT("a\xFF" "b", "a?b");
+
+    if (failures == 0)
+        printf("marquee_text_test: all checks passed\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,345 @@
+// Simulation of loop()'s schedule: polls every 4s handed to the poll task,
+// transition frames and marquee steps, with the real Compositor, Marquee and
+// PowerGovernor on the virtual clock. Sleeps wake on a 1 kHz RTOS tick like
+// vTaskDelay, or as soon as the poll task notifies the loop. Each kind of
+// work costs a fixed (estimated) time; the poll task runs on the other core,
+// so its network and decoding time does not hold up the loop.
+//
+// Deadlines are tracked independently of msUntilNextDeadline() from what the
+// loop actually did (last poll, last frame, last marquee step, poll task
+// finishing). The test fails if a sleep ends more than a millisecond past
+// the earliest pending deadline, if a step, frame or poll is served more
+// than a millisecond late for any other reason than the loop drawing at
+// that moment, or if anything runs below the active clock.
+
+#include <compositor.h>
+#include <marquee.h>
+#include <power_governor.h>
+#include <schedule.h>
+#include <limits.h>
+#include <stdio.h>
+
+// Work estimates in microseconds; replace with device measurements
+#define POLL_WORK_US 150000  // poll task: HTTPS request and JSON parse
+#define COVER_WORK_US 900000 // poll task: download and decode of a new cover
+#define SLOW_COVER_US 5000000 // poll task: the same on a slow network (every 4th track)
+#define CACHE_WORK_US 40000  // poll task: cover restored from /cover.rle
+#define APPLY_US 300         // loop: copy the cover in, rasterize the marquee text
+#define CLOCK_US 1000        // loop: draw the clock layer
+#define FULL_FRAME_US 3000   // loop: compose and push 64 rows
+#define ROWS_FRAME_US 400    // loop: compose and push the marquee rows
+
+#define TICK_US 1000 // FreeRTOS tick at 1 kHz
+#define WAKE_US 30   // tick interrupt or notification to the loop task running
+#define LATE_US 1000 // PowerGovernor counts a wake this late as missed
+
+#define SIM_SECONDS 900
+
+static int failures = 0;
+
+// The loop's last piece of work, which anything falling due meanwhile waits for
+static uint64_t busyFromUs = 0, busyToUs = 0;
+
+// Poll task: running from the loop's notify until doneUs, then it notifies back
+static bool pollRunning = false;
+static bool pollDone = false;
+static bool notifyPending = false;
+static uint64_t pollDoneUs = 0;
+
+static void fail(const char *message, double value)
+{
+    if (failures++ < 10)
+        printf(message, value);
+}
+
+static void updatePollTask()
+{
+    if (pollRunning && hostClockUs >= pollDoneUs)
+    {
+        pollRunning = false;
+        pollDone = true;
+        notifyPending = true;
+    }
+}
+
+// ulTaskNotifyTake(ms): the ms-th tick interrupt from now, or the poll task's
+// notification if that comes first
+static void rtosWait(unsigned long ms)
+{
+    if (pollRunning && hostCpuMhz != CONFIG_CPU_ACTIVE_MHZ)
+        fail("poll task ran at %.0f MHz\n", hostCpuMhz);
+
+    updatePollTask();
+    if (notifyPending)
+    {
+        notifyPending = false;
+        hostClockUs += WAKE_US;
+        return;
+    }
+
+    uint64_t wake = (hostClockUs / TICK_US + ms) * TICK_US + WAKE_US;
+    if (pollRunning && pollDoneUs + WAKE_US < wake)
+        wake = pollDoneUs + WAKE_US;
+    hostClockUs = wake;
+
+    updatePollTask();
+    notifyPending = false; // consumed by this wait
+}
+
+// Runs loop work at the current clock, flagging anything below full speed
+static void work(uint64_t us)
+{
+    if (hostCpuMhz != CONFIG_CPU_ACTIVE_MHZ)
+        fail("loop work ran at %.0f MHz\n", hostCpuMhz);
+    busyFromUs = hostClockUs;
+    hostClockUs += us;
+    busyToUs = hostClockUs;
+}
+
+// Playback script: clock, then tracks every 45s with a pause, then clock
+static bool playingAt(unsigned long s) { return (s >= 60 && s < 300) || (s >= 330 && s < 600); }
+static int trackAt(unsigned long s) { return (int)(s - 60) / 45; }
+
+struct Lateness
+{
+    const char *name;
+    uint32_t count = 0;
+    uint32_t waited = 0; // fell due while the loop was drawing
+    uint32_t late = 0;   // anything else
+    uint64_t maxWaitUs = 0;
+    uint64_t maxLateUs = 0;
+
+    void serve(uint64_t dueUs)
+    {
+        count++;
+        if (hostClockUs <= dueUs + LATE_US)
+            return;
+        uint64_t lateUs = hostClockUs - dueUs;
+        if (dueUs >= busyFromUs && hostClockUs <= busyToUs + LATE_US)
+        {
+            waited++;
+            maxWaitUs = lateUs > maxWaitUs ? lateUs : maxWaitUs;
+            return;
+        }
+        late++;
+        maxLateUs = lateUs > maxLateUs ? lateUs : maxLateUs;
+        fail("late by %.3f ms\n", lateUs / 1000.0);
+    }
+
+    void print() const
+    {
+        printf("  %-18s %6u, %u late, %u waited for the loop's drawing (max %.1f ms)\n", name, count, late, waited,
+               maxWaitUs / 1000.0);
+    }
+};
+
+class NullDisplay : public Adafruit_GFX
+{
+};
+
+int main()
+{
+    static GFXglyph glyphs[0x7E - 0x20 + 1];
+    for (GFXglyph &g : glyphs)
+        g.xAdvance = 4;
+    GFXfont font = {nullptr, glyphs, 0x20, 0x7E, 7};
+
+    GFXcanvas16 coverLayer(PANEL_RES_X, PANEL_RES_Y), clockLayer(PANEL_RES_X, PANEL_RES_Y), overlayLayer(PANEL_RES_X, PANEL_RES_Y);
+    Compositor compositor;
+    Marquee marquee(&font);
+    PowerGovernor governor;
+    NullDisplay display;
+    if (!compositor.begin(true))
+        return 1;
+    // Attached as setup() does
+    compositor.attach(LAYER_COVER, &coverLayer);
+    compositor.attach(LAYER_CLOCK, &clockLayer);
+    overlayLayer.fillScreen(0);
+    compositor.attach(LAYER_OVERLAY, &overlayLayer, true);
+    compositor.setAlpha(LAYER_OVERLAY, 24);
+    const uint32_t coverScene = LAYER_BIT(LAYER_COVER) | LAYER_BIT(LAYER_OVERLAY);
+
+    hostDelayHook = rtosWait;
+    governor.begin();
+
+    unsigned long lastPoll = 0, lastFrame = 0;
+    bool firstPoll = true, pollBusy = false;
+
+    // Poll task state and what it hands to the loop
+    int shownTrack = -1, cachedTrack = -1;
+    bool outPlaying = false, outTrackChanged = false, outCoverChanged = false;
+
+    // What the oracle knows, from observed events only
+    unsigned long seenPollMs = 0, seenFrameMs = 0, seenStepMs = 0;
+    uint64_t appliedUs = 0;
+    bool polled = false, framePending = false;
+    Lateness polls{"polls"}, frames{"transition frames"}, steps{"marquee steps"};
+    uint32_t overshoots = 0, deferredPolls = 0, spins = 0;
+    uint64_t maxOvershootUs = 0, transitionFrames = 0, transitionUs = 0;
+
+    while (hostClockUs < (uint64_t)SIM_SECONDS * 1000000)
+    {
+        // loop()
+        uint64_t passUs = hostClockUs;
+        governor.active();
+        updatePollTask();
+
+        if (pollDone)
+        {
+            // updateScreen()
+            pollDone = false;
+            if (outPlaying)
+            {
+                work(APPLY_US);
+                if (outTrackChanged)
+                    marquee.setText("A fairly long track title - Some Artist, Another Artist");
+                if (outCoverChanged)
+                {
+                    bool wasShowingCover = compositor.isShowing(coverScene);
+                    compositor.invalidate();
+                    if (wasShowingCover)
+                        compositor.refresh(Compositor::Transition::Slide, millis());
+                }
+                compositor.show(coverScene, Compositor::Transition::Crossfade, millis());
+            }
+            else
+            {
+                work(CLOCK_US);
+                clockLayer.fillScreen(0);
+                compositor.show(LAYER_BIT(LAYER_CLOCK), Compositor::Transition::Crossfade, millis());
+            }
+            pollBusy = false;
+            appliedUs = hostClockUs;
+        }
+
+        unsigned long now = millis();
+        if (!pollBusy && (firstPoll || now - lastPoll >= POLL_INTERVAL_MS))
+        {
+            if (polled)
+            {
+                // A poll that came due while the last one ran starts when that is applied
+                uint64_t dueUs = (uint64_t)(seenPollMs + POLL_INTERVAL_MS) * 1000;
+                if (appliedUs > dueUs)
+                {
+                    deferredPolls++;
+                    dueUs = appliedUs;
+                }
+                polls.serve(dueUs);
+            }
+            polled = true;
+            seenPollMs = now;
+
+            firstPoll = false;
+            lastPoll = now;
+            pollBusy = true;
+
+            // pollSpotify(), on the other core
+            uint64_t cost = POLL_WORK_US;
+            unsigned long s = now / 1000;
+            outPlaying = playingAt(s);
+            outTrackChanged = outCoverChanged = false;
+            if (outPlaying && trackAt(s) != shownTrack)
+            {
+                if (trackAt(s) == cachedTrack)
+                    cost += CACHE_WORK_US;
+                else
+                    cost += trackAt(s) % 4 == 3 ? SLOW_COVER_US : COVER_WORK_US;
+                shownTrack = cachedTrack = trackAt(s);
+                outTrackChanged = outCoverChanged = true;
+            }
+            else if (!outPlaying)
+            {
+                shownTrack = -1; // main.cpp resets the cover URL when the clock shows
+            }
+            pollRunning = true;
+            pollDoneUs = hostClockUs + cost;
+        }
+
+        if (!compositor.isShowing(coverScene))
+            seenStepMs = 0; // no steps are due while the clock shows
+
+        if (compositor.isShowing(coverScene) && marquee.tick(overlayLayer, MARQUEE_Y, millis()))
+        {
+            // A step (not just a redraw of new text) restarts the step timer
+            if (marquee.msUntilStep(millis(), ULONG_MAX) == CONFIG_MARQUEE_STEP_MS)
+            {
+                if (seenStepMs != 0)
+                    steps.serve((uint64_t)(seenStepMs + CONFIG_MARQUEE_STEP_MS) * 1000);
+                seenStepMs = millis();
+            }
+            compositor.invalidateRows(MARQUEE_Y, MARQUEE_Y + Marquee::height);
+        }
+
+        bool animating = compositor.isAnimating();
+        unsigned long frameTime = millis();
+        if (compositor.render(display, frameTime))
+        {
+            if (animating)
+            {
+                if (framePending)
+                {
+                    frames.serve((uint64_t)(seenFrameMs + FRAME_INTERVAL_MS) * 1000);
+                    transitionUs += (uint64_t)(frameTime - seenFrameMs) * 1000;
+                    transitionFrames++;
+                }
+                seenFrameMs = frameTime;
+            }
+            work(animating ? FULL_FRAME_US : ROWS_FRAME_US);
+            lastFrame = frameTime;
+        }
+        framePending = compositor.isAnimating();
+
+        // Earliest deadline the coming sleep must not pass: the next poll, or
+        // the running one finishing
+        updatePollTask();
+        uint64_t dueUs = pollBusy ? (pollDone ? hostClockUs : pollDoneUs) : (uint64_t)(seenPollMs + POLL_INTERVAL_MS) * 1000;
+        if (framePending && (uint64_t)(seenFrameMs + FRAME_INTERVAL_MS) * 1000 < dueUs)
+            dueUs = (uint64_t)(seenFrameMs + FRAME_INTERVAL_MS) * 1000;
+        bool stepping = compositor.isShowing(coverScene) && marquee.msUntilStep(0, ULONG_MAX) != ULONG_MAX;
+        if (stepping && seenStepMs != 0 && (uint64_t)(seenStepMs + CONFIG_MARQUEE_STEP_MS) * 1000 < dueUs)
+            dueUs = (uint64_t)(seenStepMs + CONFIG_MARQUEE_STEP_MS) * 1000;
+
+        uint64_t sleepUs = hostClockUs;
+        now = millis();
+        unsigned long stepWait = POLL_INTERVAL_MS;
+        if (compositor.isShowing(coverScene))
+            stepWait = marquee.msUntilStep(now, POLL_INTERVAL_MS);
+        governor.idleFor(msUntilNextDeadline(now, lastPoll, POLL_INTERVAL_MS, pollBusy, compositor.isAnimating(), lastFrame,
+                                             FRAME_INTERVAL_MS, stepWait),
+                         pollBusy);
+
+        if (hostClockUs == passUs && ++spins > 1000)
+        {
+            fail("loop spins without sleeping at %.3f s\n", hostClockUs / 1e6);
+            break;
+        }
+        if (hostClockUs != passUs)
+            spins = 0;
+
+        // A deadline that passed while the loop was busy is not the sleep's fault
+        if (dueUs < sleepUs)
+            dueUs = sleepUs;
+        if (hostClockUs > dueUs + LATE_US)
+        {
+            overshoots++;
+            fail("sleep ended %.3f ms past a deadline\n", (hostClockUs - dueUs) / 1000.0);
+        }
+        if (hostClockUs > dueUs && hostClockUs - dueUs > maxOvershootUs)
+            maxOvershootUs = hostClockUs - dueUs;
+    }
+
+    const PowerGovernor::Metrics &power = governor.stats();
+    printf("schedule_sim: %d s simulated, %u wakes, duty %u.%u%%\n", SIM_SECONDS, power.wakes,
+           power.dutyPermille() / 10, power.dutyPermille() % 10);
+    polls.print();
+    frames.print();
+    steps.print();
+    printf("  %u polls came due while a cover was still loading and started right after it\n", deferredPolls);
+    printf("  transition frames every %.2f ms on average (marquee steps add frames)\n",
+           transitionFrames ? transitionUs / 1000.0 / transitionFrames : 0.0);
+    printf("  sleeps past a deadline: %u (max %.3f ms after it)\n", overshoots, maxOvershootUs / 1000.0);
+
+    if (failures == 0)
+        printf("schedule_sim: all checks passed\n");
+    return failures == 0 ? 0 : 1;
+}
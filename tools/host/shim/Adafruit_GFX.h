@@ -0,0 +1,71 @@
+// Host stand-in for Adafruit GFX: canvases own their pixels, drawing text is
+// not emulated. Displays derive from Adafruit_GFX and receive the bitmaps.
+#pragma once
+
+#include <Arduino.h>
+
+struct GFXglyph
+{
+    uint16_t bitmapOffset;
+    uint8_t width;
+    uint8_t height;
+    uint8_t xAdvance;
+    int8_t xOffset;
+    int8_t yOffset;
+};
+
+struct GFXfont
+{
+    uint8_t *bitmap;
+    GFXglyph *glyph;
+    uint16_t first;
+    uint16_t last;
+    uint8_t yAdvance;
+};
+
+class Adafruit_GFX
+{
+public:
+    virtual ~Adafruit_GFX() = default;
+    virtual void drawRGBBitmap(int16_t, int16_t, uint16_t *, int16_t, int16_t) {}
+};
+
+class GFXcanvas16 : public Adafruit_GFX
+{
+public:
+    GFXcanvas16(uint16_t w, uint16_t h) : buffer((uint16_t *)calloc(w * h, sizeof(uint16_t))), w(w), h(h) {}
+    ~GFXcanvas16() { free(buffer); }
+
+    uint16_t *getBuffer() const { return buffer; }
+
+    void fillScreen(uint16_t color)
+    {
+        for (int i = 0; i < w * h; ++i)
+            buffer[i] = color;
+    }
+
+private:
+    uint16_t *buffer;
+    int w;
+    int h;
+};
+
+class GFXcanvas1 : public Adafruit_GFX
+{
+public:
+    GFXcanvas1(uint16_t w, uint16_t h) : buffer((uint8_t *)calloc((w + 7) / 8 * h, 1)), bytes((w + 7) / 8 * h) {}
+    ~GFXcanvas1() { free(buffer); }
+
+    uint8_t *getBuffer() const { return buffer; }
+
+    void fillScreen(uint16_t color) { memset(buffer, color ? 0xFF : 0x00, bytes); }
+    void setFont(const GFXfont *) {}
+    void setTextWrap(bool) {}
+    void setTextColor(uint16_t) {}
+    void setCursor(int16_t, int16_t) {}
+    void print(const String &) {}
+
+private:
+    uint8_t *buffer;
+    int bytes;
+};
@@ -0,0 +1,51 @@
+// Host stand-in for the parts of the Arduino core the headers in include/ use
+#pragma once
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+class String : public std::string
+{
+public:
+    String() = default;
+    String(const char *s) : std::string(s ? s : "") {}
+    String(const std::string &s) : std::string(s) {}
+
+    bool equals(const String &other) const { return compare(other) == 0; }
+};
+
+// Virtual clock: time only moves when delay() is called or a test sets it
+inline uint64_t hostClockUs = 0;
+
+inline unsigned long millis() { return (unsigned long)(hostClockUs / 1000); }
+inline unsigned long micros() { return (unsigned long)hostClockUs; }
+// Simulations can replace delay() to model the RTOS tick and wake latency
+inline void (*hostDelayHook)(unsigned long ms) = nullptr;
+
+inline void delay(unsigned long ms)
+{
+    if (hostDelayHook)
+        hostDelayHook(ms);
+    else
+        hostClockUs += (uint64_t)ms * 1000;
+}
+
+// FreeRTOS task notifications: a wait is a delay() that a simulation's
+// delay hook may end early
+#define pdTRUE 1
+#define pdMS_TO_TICKS(ms) (ms)
+inline uint32_t ulTaskNotifyTake(int, uint32_t ticks)
+{
+    delay(ticks);
+    return 0;
+}
+
+inline uint32_t hostCpuMhz = 240;
+inline bool setCpuFrequencyMhz(uint32_t mhz)
+{
+    hostCpuMhz = mhz;
+    return true;
+}
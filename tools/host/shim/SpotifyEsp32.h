@@ -0,0 +1,70 @@
+// Host stub of SpotifyEsp32: replies and token refresh results are scripted
+// by the test, and every call is recorded with the time it was made
+#pragma once
+
+#include <Arduino.h>
+#include <deque>
+#include <map>
+#include <vector>
+
+class StubJsonValue
+{
+public:
+    explicit StubJsonValue(const std::string &text) : text(text) {}
+
+    template <typename T>
+    T as() const { return T(text.c_str()); }
+
+private:
+    std::string text;
+};
+
+struct StubJson
+{
+    std::map<std::string, std::string> fields;
+
+    StubJsonValue operator[](const char *key) const
+    {
+        auto it = fields.find(key);
+        return StubJsonValue(it == fields.end() ? "" : it->second);
+    }
+};
+
+struct response
+{
+    int status_code = 0;
+    StubJson reply;
+};
+
+class Spotify
+{
+public:
+    std::deque<response> replies; // served in order, then 200
+    std::deque<bool> tokenResults; // served in order, then true
+    std::vector<unsigned long> requestTimes;
+    int tokenCalls = 0;
+
+    response currently_playing()
+    {
+        requestTimes.push_back(millis());
+        if (replies.empty())
+        {
+            response ok;
+            ok.status_code = 200;
+            return ok;
+        }
+        response r = replies.front();
+        replies.pop_front();
+        return r;
+    }
+
+    bool get_access_token()
+    {
+        tokenCalls++;
+        if (tokenResults.empty())
+            return true;
+        bool ok = tokenResults.front();
+        tokenResults.pop_front();
+        return ok;
+    }
+};
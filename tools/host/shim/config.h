@@ -0,0 +1,5 @@
+// Host build settings; everything not set here uses the header defaults
+#pragma once
+
+#define PANEL_RES_X 64
+#define PANEL_RES_Y 64
@@ -0,0 +1,245 @@
+// SpotifyClient against a stub that injects 401, 429, timeouts and failed
+// token refreshes. Checks the counters and when requests actually go out,
+// also across millis() wrapping.
+
+#define CONFIG_SPOTIFY_HOURLY_BUDGET 20 // small enough to exhaust in a test
+
+#include <spotify_client.h>
+#include <stdio.h>
+#include <vector>
+
+#define POLL_MS 4000
+
+static int failures = 0;
+
+#define CHECK_EQ(actual, expected)                                                      \
+    do                                                                                  \
+    {                                                                                   \
+        unsigned long a = (actual), e = (expected);                                     \
+        if (a != e)                                                                     \
+        {                                                                               \
+            printf("%s:%d: %s is %lu, expected %lu\n", __FILE__, __LINE__, #actual, a, e); \
+            failures++;                                                                 \
+        }                                                                               \
+    } while (0)
+
+static response reply(int code, const char *message = nullptr)
+{
+    response r;
+    r.status_code = code;
+    if (message)
+        r.reply.fields["message"] = message;
+    return r;
+}
+
+// Polls like loop() does, every POLL_MS in [start, end)
+static void pollUntil(SpotifyClient &client, unsigned long start, unsigned long end)
+{
+    for (unsigned long t = start; t < end; t += POLL_MS)
+    {
+        hostClockUs = (uint64_t)t * 1000;
+        response r;
+        client.currentlyPlaying(r, t);
+    }
+}
+
+// Same with 32-bit timestamps as millis() gives them on the ESP32: count
+// polls from start, wrapping at 2^32 ms
+static void pollWrapping(SpotifyClient &client, uint32_t start, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        uint32_t t = start + (uint32_t)i * POLL_MS;
+        hostClockUs = (uint64_t)t * 1000;
+        response r;
+        client.currentlyPlaying(r, t);
+    }
+}
+
+static void checkTimes(const std::vector<unsigned long> &actual, const std::vector<unsigned long> &expected, int line)
+{
+    if (actual != expected)
+    {
+        printf("%s:%d: request times differ\n  actual:  ", __FILE__, line);
+        for (unsigned long t : actual)
+            printf(" %lu", t);
+        printf("\n  expected:");
+        for (unsigned long t : expected)
+            printf(" %lu", t);
+        printf("\n");
+        failures++;
+    }
+}
+
+static void testRateLimited()
+{
+    Spotify sp;
+    SpotifyClient client(sp);
+    client.markTokenRefreshed(0);
+    sp.replies = {reply(429), reply(200)};
+
+    pollUntil(client, 0, 40000);
+
+    // 30s wait: polls at 4..28s never reach the network
+    checkTimes(sp.requestTimes, {0, 32000, 36000}, __LINE__);
+    const SpotifyClient::Counters &c = client.stats();
+    CHECK_EQ(c.rateLimited, 1);
+    CHECK_EQ(c.failures, 0);
+    CHECK_EQ(c.skippedBackoff, 7);
+    CHECK_EQ(c.wastedCallsAvoided(), 7);
+    CHECK_EQ((int)client.breakerState(), (int)SpotifyClient::Breaker::Closed);
+}
+
+static void testUnauthorized()
+{
+    Spotify sp;
+    SpotifyClient client(sp);
+    client.markTokenRefreshed(0);
+    sp.replies = {reply(401)};
+
+    pollUntil(client, 0, 12000);
+
+    // Token refreshed right away, request repeated at the next poll after
+    // the first backoff step instead of immediately
+    checkTimes(sp.requestTimes, {0, 4000, 8000}, __LINE__);
+    const SpotifyClient::Counters &c = client.stats();
+    CHECK_EQ(sp.tokenCalls, 1);
+    CHECK_EQ(c.tokenRefreshes, 1);
+    CHECK_EQ(c.failures, 1);
+    CHECK_EQ(c.retriesAvoided, 1);
+}
+
+static void testTimeoutsOpenBreaker()
+{
+    Spotify sp;
+    SpotifyClient client(sp);
+    client.markTokenRefreshed(0);
+    for (int i = 0; i < CONFIG_SPOTIFY_BREAKER_THRESHOLD; ++i)
+        sp.replies.push_back(i % 2 ? reply(-1) : reply(400, "Timeout receiving headers"));
+    sp.replies.push_back(reply(-1)); // half-open probe fails
+    sp.replies.push_back(reply(200)); // next probe succeeds
+
+    pollUntil(client, 0, 60000);
+    CHECK_EQ((int)client.breakerState(), (int)SpotifyClient::Breaker::Closed);
+
+    // Backoff doubles from 4s: requests at 0, 4, 12, 28 and 60s
+    pollUntil(client, 60000, 360000);
+    CHECK_EQ((int)client.breakerState(), (int)SpotifyClient::Breaker::Open);
+
+    // Cooldown of 300s from the 5th failure, then a single probe
+    pollUntil(client, 360000, 364000);
+    CHECK_EQ((int)client.breakerState(), (int)SpotifyClient::Breaker::Open);
+
+    pollUntil(client, 364000, 680000);
+    CHECK_EQ((int)client.breakerState(), (int)SpotifyClient::Breaker::Closed);
+
+    checkTimes(sp.requestTimes, {0, 4000, 12000, 28000, 60000, 360000, 660000, 664000, 668000, 672000, 676000}, __LINE__);
+    const SpotifyClient::Counters &c = client.stats();
+    CHECK_EQ(c.requests, 11);
+    CHECK_EQ(c.failures, 6);
+    CHECK_EQ(c.retriesAvoided, 6);
+    CHECK_EQ(c.skippedBackoff + c.skippedBreaker, 170 - 11);
+    CHECK_EQ(c.wastedCallsAvoided(), 170 - 11 + 6);
+}
+
+static void testProactiveRefresh()
+{
+    Spotify sp;
+    SpotifyClient client(sp);
+    client.markTokenRefreshed(0);
+    const unsigned long refreshAt = (CONFIG_SPOTIFY_TOKEN_LIFETIME_S - CONFIG_SPOTIFY_TOKEN_REFRESH_MARGIN_S) * 1000UL;
+
+    response r;
+    client.currentlyPlaying(r, refreshAt - 1);
+    CHECK_EQ(sp.tokenCalls, 0);
+
+    client.currentlyPlaying(r, refreshAt);
+    CHECK_EQ(sp.tokenCalls, 1);
+    CHECK_EQ(client.stats().requests, 2);
+    CHECK_EQ(client.stats().failures, 0);
+}
+
+static void testFailedRefresh()
+{
+    Spotify sp;
+    SpotifyClient client(sp);
+    sp.tokenResults = {false};
+
+    // No token yet and the refresh fails: no request goes out
+    response r;
+    CHECK_EQ((int)client.currentlyPlaying(r, 0), (int)SpotifyClient::Result::Failed);
+    CHECK_EQ((int)client.currentlyPlaying(r, 1000), (int)SpotifyClient::Result::Skipped);
+    CHECK_EQ((int)client.currentlyPlaying(r, 4000), (int)SpotifyClient::Result::Ok);
+
+    const SpotifyClient::Counters &c = client.stats();
+    CHECK_EQ(sp.requestTimes.size(), 1);
+    CHECK_EQ(c.tokenRefreshes, 2);
+    CHECK_EQ(c.failures, 1);
+    CHECK_EQ(c.skippedBackoff, 1);
+}
+
+static void testHourlyBudget()
+{
+    Spotify sp;
+    SpotifyClient client(sp);
+    client.markTokenRefreshed(0);
+
+    pollUntil(client, 0, 3600000);
+    CHECK_EQ(client.stats().requests, CONFIG_SPOTIFY_HOURLY_BUDGET);
+    CHECK_EQ(client.stats().skippedBudget, 900 - CONFIG_SPOTIFY_HOURLY_BUDGET);
+
+    // A new window opens an hour after the first one
+    pollUntil(client, 3600000, 3604000);
+    CHECK_EQ(client.stats().requests, CONFIG_SPOTIFY_HOURLY_BUDGET + 1);
+    CHECK_EQ(client.requestsInWindow(), 1);
+}
+
+static void testMillisWrap()
+{
+    Spotify sp;
+    SpotifyClient client(sp);
+    client.markTokenRefreshed(0);
+    sp.replies = {reply(429)};
+    pollUntil(client, 0, 40000);
+    CHECK_EQ(client.stats().skippedBackoff, 7);
+
+    // ~24.9 days later the 30s wait set at 0 must not come back
+    pollWrapping(client, 0x80000000u - 40000, 15);
+    CHECK_EQ(client.stats().skippedBackoff, 7);
+    CHECK_EQ(client.stats().requests, 3 + 15);
+
+    // A breaker opened just before millis() wraps closes after its cooldown
+    const uint32_t start = 0xFFFFFFFFu - 100000;
+    for (int i = 0; i < CONFIG_SPOTIFY_BREAKER_THRESHOLD; ++i)
+        sp.replies.push_back(reply(-1));
+    pollWrapping(client, start, 16); // failures at 0, 4, 12, 28 and 60s
+    CHECK_EQ((int)client.breakerState(), (int)SpotifyClient::Breaker::Open);
+
+    pollWrapping(client, start + 64000, 74); // cooldown, across the wrap
+    CHECK_EQ((int)client.breakerState(), (int)SpotifyClient::Breaker::Open);
+    CHECK_EQ(client.stats().requests, 3 + 15 + 5);
+
+    pollWrapping(client, start + 360000, 2); // probe 300s after the 5th failure
+    CHECK_EQ((int)client.breakerState(), (int)SpotifyClient::Breaker::Closed);
+    CHECK_EQ((uint32_t)sp.requestTimes[3 + 15 + 5], start + 360000);
+
+    // Back at day ~25 of the next wrap the old waits are still ignored
+    uint32_t skipped = client.stats().skippedBackoff + client.stats().skippedBreaker;
+    pollWrapping(client, 0x80000000u - 40000, 15);
+    CHECK_EQ(client.stats().skippedBackoff + client.stats().skippedBreaker, skipped);
+}
+
+int main()
+{
+    testRateLimited();
+    testUnauthorized();
+    testTimeoutsOpenBreaker();
+    testProactiveRefresh();
+    testFailedRefresh();
+    testHourlyBudget();
+    testMillisWrap();
+
+    if (failures == 0)
+        printf("spotify_client_test: all checks passed\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""Decode binary log records (CONFIG_LOG_BINARY 1) into text.
+
+Records only carry the address of their format string, so the firmware ELF
+the device is running is needed to look the strings up.
+
+Usage:
+  tools/log_decode.py .pio/build/esp32-s3-devkitc-1/firmware.elf /dev/ttyACM0
+  tools/log_decode.py firmware.elf capture.bin
+
+Needs pyelftools, and pyserial when reading from a port.
+"""
+
+import re
+import struct
+import sys
+
+from elftools.elf.elffile import ELFFile
+
+LOG_SYNC = 0xA5
+HEADER = struct.Struct("<IIBBBB")  # format, ms, level, argCount, stringMask, stringBytes
+LEVELS = "-EWID"
+
+# printf conversion: flags, width, precision, length modifier, conversion
+CONVERSION = re.compile(r"%([-+ #0]*)(\d*|\*)(\.\d+)?(hh|h|ll|l|z|j|t)?([diouxXcsp%])")
+
+
+class FormatTable:
+    def __init__(self, elf_path):
+        self.sections = []
+        self.cache = {}
+        with open(elf_path, "rb") as f:
+            elf = ELFFile(f)
+            for section in elf.iter_sections():
+                if section["sh_addr"] and section["sh_type"] == "SHT_PROGBITS":
+                    self.sections.append((section["sh_addr"], section.data()))
+
+    def lookup(self, address):
+        if address in self.cache:
+            return self.cache[address]
+        text = "<unknown format 0x%08x>" % address
+        for base, data in self.sections:
+            if base <= address < base + len(data):
+                end = data.index(b"\0", address - base)
+                text = data[address - base:end].decode("utf-8", "replace")
+                break
+        self.cache[address] = text
+        return text
+
+
+def format_record(fmt, words, strings):
+    args = iter(zip(words, strings))
+
+    def convert(match):
+        flags, width, precision, _, conversion = match.groups()
+        if conversion == "%":
+            return "%"
+        word, string = next(args, (0, None))
+        spec = "%" + flags + width + (precision or "")
+        if conversion == "s":
+            return (spec + "s") % (string if string is not None else "(null)")
+        if conversion == "p":
+            return "0x%08x" % word
+        if conversion in "di":
+            word = word - (1 << 32) if word & 0x80000000 else word
+            return (spec + "d") % word
+        if conversion == "c":
+            return (spec + "c") % chr(word & 0xFF)
+        return (spec + conversion.replace("u", "d")) % word
+
+    return CONVERSION.sub(convert, fmt)
+
+
+def decode_record(record, table):
+    fmt_addr, ms, level, count, string_mask, string_bytes = HEADER.unpack_from(record)
+    offset = HEADER.size
+    words = list(struct.unpack_from("<%dI" % count, record, offset))
+    offset += 4 * count
+
+    raw = record[offset:offset + string_bytes].split(b"\0")
+    strings = []
+    for i in range(count):
+        if string_mask & (1 << i):
+            strings.append(raw.pop(0).decode("utf-8", "replace"))
+        else:
+            strings.append(None)
+
+    level_char = LEVELS[level] if level < len(LEVELS) else "?"
+    return "[%d] %s %s" % (ms, level_char, format_record(table.lookup(fmt_addr), words, strings))
+
+
+def open_input(source):
+    """Returns (read, is_file); a port read times out empty, a file ends."""
+    if source.startswith("/dev/") or source.upper().startswith("COM"):
+        import serial
+
+        port = serial.Serial(source, 115200, timeout=1)
+        return port.read, False
+    f = open(source, "rb")
+    return f.read, True
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__.strip())
+        return 1
+
+    table = FormatTable(sys.argv[1])
+    read, is_file = open_input(sys.argv[2])
+
+    while True:
+        sync = read(1)
+        if not sync:
+            if is_file:
+                return 0
+            continue
+        if sync[0] != LOG_SYNC:
+            continue  # resynchronise on the next frame
+
+        size = read(1)
+        if not size:
+            continue
+        record = read(size[0])
+        while len(record) < size[0]:
+            more = read(size[0] - len(record))
+            if not more and is_file:
+                return 0
+            record += more
+
+        if len(record) >= HEADER.size:
+            print(decode_record(record, table), flush=True)
+
+
+if __name__ == "__main__":
+    sys.exit(main())